@@ -3,16 +3,22 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <SDL_ttf.h>    // Librería para renderizado de fuentes
 #include <SDL_mixer.h>  // Librería para manejo de audio
 
-// ========================== Definiciones ==========================
+// Proyección de archivos en memoria para los packs de niveles
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-// Dimensiones máximas del mapa
-#define COLUMNAS 50
-#define FILAS 50
-char maze[FILAS][COLUMNAS]; // Mapa del laberinto
+// ========================== Definiciones ==========================
 
 // Tamaño de cada celda en píxeles (cada tile mide 30x30 píxeles)
 #define TILE_SIZE 38    
@@ -28,15 +34,32 @@ char maze[FILAS][COLUMNAS]; // Mapa del laberinto
 #define GHOST2 'H'
 #define GHOST3 'I'
 
-// Longitud máxima del camino calculado (A*), usado para IA de fantasmas
-#define LONGITUD_MAXIMA_CAMINO 100
-
 // Velocidades de los personajes (menor valor, más rápido)
 #define VELOCIDAD_PACMAN 100
 #define VELOCIDAD_FANTASMA 400
 #define VELOCIDAD_FANTASMA2 200
 #define VELOCIDAD_FANTASMA3 300
 
+// Duración de un tick de simulación en milisegundos. Las velocidades y los
+// retardos de salida de los fantasmas se cuentan en ticks, así que equivalen
+// a milisegundos reales sin importar cuánto tarde en dibujarse cada cuadro
+#define PASO_SIMULACION_MS 1
+
+// Máximo de ticks que se simulan por cuadro (evita que una pausa larga, por
+// ejemplo al arrastrar la ventana, dispare miles de ticks de golpe)
+#define MAX_TICKS_POR_CUADRO 250
+
+// Cuadros por segundo cuando no hay sincronización vertical disponible
+#define FPS_SIN_VSYNC 60
+
+// Fantasmas marcados en cada mapa (G, H, I): cada uno tiene su posición inicial,
+// su velocidad y su retardo de salida. Si un nivel tiene más fantasmas, el
+// fantasma i sale de la posición y con los valores del fantasma i % CANT_FANTASMAS
+#define CANT_FANTASMAS 3
+
+// Máximo de fantasmas por nivel (se elige con --fantasmas=N)
+#define MAX_FANTASMAS 1000
+
 // Cantidad total de niveles en el juego
 #define cant_tot_niv 4
 
@@ -46,30 +69,160 @@ char maze[FILAS][COLUMNAS]; // Mapa del laberinto
 
 // ========================== Estructuras de Datos ==========================
 
+// Estructura para representar una posición en el mapa
+typedef struct {
+    int x, y; // Coordenadas X e Y
+} Posicion;
+
+// Cantidad de celdas a la que se redondea el paso entre filas de las rejillas:
+// así cada fila de una rejilla de int empieza en su propia línea de caché (64 bytes)
+#define ALINEACION_FILAS 16
+
+// Paso entre filas de una rejilla para un mapa de "columnas" columnas
+static inline int paso_filas(int columnas) {
+    return (columnas + ALINEACION_FILAS - 1) / ALINEACION_FILAS * ALINEACION_FILAS;
+}
+
 // Estructura para representar un mapa
+// Las celdas se guardan fila por fila en memoria dinámica, así el tamaño del
+// mapa lo decide el archivo y no hay un máximo fijado al compilar. Todas las
+// rejillas del mapa (y las de la búsqueda de caminos) usan el mismo paso entre
+// filas; las celdas de relleno al final de cada fila son paredes que no se dibujan.
 typedef struct {
-    char maze[FILAS][COLUMNAS]; // Matriz que representa el laberinto
+    char* celdas;               // Laberinto: filas * paso caracteres, fila por fila
+    Uint64* paredes;            // Máscara de paredes: un bit por celda, en el mismo orden que "celdas"
+    int* puntos;                // Índice de los puntos: posición (y * paso + x) de cada punto al cargar
+    Uint8* vecinos;             // Tabla de vecinos: por celda, bit d encendido si se puede pasar en la dirección d
+    struct TablaSaltos* saltos; // Primer paso entre cada par de celdas libres (NULL si no se precalculó)
+    struct Jerarquia* jerarquia; // Grafo de clusters para la búsqueda jerárquica (NULL si no se precalculó)
     char* nombre;               // Nombre del archivo del mapa
     int columnas, filas;        // Número de columnas y filas del mapa
+    int paso;                   // Celdas entre dos filas consecutivas (columnas más el relleno)
+    int puntos_totales;         // Puntos necesarios para completar el nivel (entradas de "puntos")
+    Posicion inicio_pacman;                     // Posición inicial de Pac-Man
+    Posicion inicio_fantasmas[CANT_FANTASMAS];  // Posiciones iniciales de los fantasmas
+    const struct NivelPack* nivel_pack;         // Entrada del pack de niveles (NULL si el mapa se lee de un archivo de texto)
+    Uint32 cambios;             // Celdas cambiadas con mapa_cambiar_celda desde que se leyó (0: igual al archivo)
 } Mapa;
 
-// Estructura para representar una posición en el mapa
+// Índice de la celda (x, y) en las celdas y la máscara de paredes del mapa
+static inline int mapa_indice(const Mapa* mapa, int x, int y) {
+    return y * mapa->paso + x;
+}
+
+// Cantidad de celdas de las rejillas del mapa, contando el relleno
+static inline int mapa_celdas(const Mapa* mapa) {
+    return mapa->filas * mapa->paso;
+}
+
+// Indica si la celda con el índice dado es una pared, según la máscara
+static inline bool mapa_es_pared(const Mapa* mapa, int indice) {
+    return (mapa->paredes[indice >> 6] >> (indice & 63)) & 1;
+}
+
+// Vista de solo lectura de un mapa: puntero y dimensiones, sin copiar el laberinto
+// Es lo que consumen el movimiento y la búsqueda de caminos en cada tick
 typedef struct {
-    int x, y; // Coordenadas X e Y
-} Posicion;
+    const char* celdas;         // Primera celda del laberinto
+    int paso;                   // Celdas entre dos filas consecutivas
+    int columnas, filas;        // Número de columnas y filas del mapa
+    const Uint8* vecinos;       // Tabla de vecinos del mapa (un byte por celda, con el mismo paso)
+    const struct TablaSaltos* saltos; // Tabla de saltos del mapa (NULL si no se precalculó)
+    const struct Jerarquia* jerarquia; // Jerarquía de clusters del mapa (NULL si no se precalculó)
+} VistaMapa;
+
+// Crea una vista de solo lectura sobre un mapa cargado
+static inline VistaMapa vista_mapa(const Mapa* mapa) {
+    VistaMapa vista = {mapa->celdas, mapa->paso, mapa->columnas, mapa->filas, mapa->vecinos, mapa->saltos, mapa->jerarquia};
+    return vista;
+}
+
+// Devuelve el carácter de la celda (x, y) de la vista
+static inline char vista_celda(const VistaMapa* vista, int x, int y) {
+    return vista->celdas[y * vista->paso + x];
+}
+
+// Indica si la celda (x, y) está dentro del mapa y no es una pared
+static inline bool vista_transitable(const VistaMapa* vista, int x, int y) {
+    return x >= 0 && x < vista->columnas && y >= 0 && y < vista->filas && vista_celda(vista, x, y) != OBSTACLE;
+}
+
+// Puntos que quedan en un nivel en curso: un bit por celda (con el paso del
+// mapa) y la cantidad que falta comer. Es la única fuente del puntaje y del fin
+// del nivel y solo cambia cuando Pac-Man entra en una celda; las celdas del
+// mapa conservan los puntos del archivo y no se modifican durante el juego.
+typedef struct {
+    Uint64* bits;               // Bit encendido en cada celda que todavía tiene un punto
+    int restantes;              // Puntos que quedan
+    int totales;                // Puntos del nivel al empezar
+} PuntosNivel;
+
+// Indica si la celda con el índice dado todavía tiene un punto
+static inline bool puntos_hay(const PuntosNivel* puntos, int indice) {
+    return (puntos->bits[indice >> 6] >> (indice & 63)) & 1;
+}
+
+// Come el punto de la celda, si lo hay
+// Retorna: true si había un punto
+static inline bool puntos_comer(PuntosNivel* puntos, int indice) {
+    Uint64 bit = (Uint64)1 << (indice & 63);
+    if ((puntos->bits[indice >> 6] & bit) == 0) {
+        return false;
+    }
+    puntos->bits[indice >> 6] &= ~bit;
+    puntos->restantes--;
+    return true;
+}
+
+// Puntos comidos desde el comienzo del nivel
+static inline int puntos_comidos(const PuntosNivel* puntos) {
+    return puntos->totales - puntos->restantes;
+}
 
 // ========================== Variables Globales ==========================
 
-// Arreglo de mapas para los niveles
-Mapa mapas[] = {
-    {.nombre = "Mapa_1.txt", .filas = 13, .columnas = 22}, // Nivel 1
-    {.nombre = "Mapa_2.txt", .filas = 13, .columnas = 25}, // Nivel 2
-    {.nombre = "Mapa_3.txt", .filas = 13, .columnas = 25}, // Nivel 3
-    {.nombre = "Mapa_4.txt", .filas = 13, .columnas = 25}, // Nivel 4
+// Arreglo de mapas para los niveles (el tamaño, las posiciones iniciales y
+// los puntos de cada uno se leen de su archivo)
+Mapa mapas_incluidos[] = {
+    {.nombre = "Mapa_1.txt"}, // Nivel 1
+    {.nombre = "Mapa_2.txt"}, // Nivel 2
+    {.nombre = "Mapa_3.txt"}, // Nivel 3
+    {.nombre = "Mapa_4.txt"}, // Nivel 4
+};
+
+// Niveles en juego: los incluidos o los de un pack abierto con --pack=archivo
+Mapa* mapas = mapas_incluidos;
+
+// Cantidad de niveles en juego (1 si se eligió un mapa propio con --mapa=archivo)
+int cant_niveles = cant_tot_niv;
+
+// Límite de cuadros por segundo (0 = sincronizar con vsync); se cambia con --fps=N
+int limite_fps = 0;
+
+// Estrategias de IA disponibles para los fantasmas
+enum ModoIA {
+    IA_CAMPO_DISTANCIAS, // Un único BFS desde Pac-Man compartido por todos los fantasmas
+    IA_A_ESTRELLA,       // Una búsqueda A* independiente por fantasma
+    IA_TABLA_SALTOS,     // Tabla precalculada con el primer paso entre todo par de celdas (A* si no entra en memoria)
+    IA_JERARQUICA        // HPA*: búsqueda sobre el grafo de clusters del mapa y refinamiento dentro de cada cluster
 };
 
-// Nivel actual del juego (comienza en 0)
-int nivel_actual = 0;
+// Estrategia de IA con la que arrancan las partidas (se puede cambiar con --ia=a-estrella)
+enum ModoIA modo_ia = IA_CAMPO_DISTANCIAS;
+
+// Fantasmas de cada nivel (--fantasmas=N1,N2,...): el último valor vale también
+// para los niveles siguientes; sin la opción, cada nivel tiene CANT_FANTASMAS
+#define MAX_VALORES_FANTASMAS 32
+int fantasmas_por_nivel[MAX_VALORES_FANTASMAS];
+int cant_fantasmas_por_nivel = 0;
+
+// Cantidad de fantasmas del nivel indicado
+int fantasmas_del_nivel(int nivel) {
+    if (cant_fantasmas_por_nivel == 0) {
+        return CANT_FANTASMAS;
+    }
+    return fantasmas_por_nivel[nivel < cant_fantasmas_por_nivel ? nivel : cant_fantasmas_por_nivel - 1];
+}
 
 // ========================== Variables SDL ==========================
 
@@ -77,11 +230,9 @@ int nivel_actual = 0;
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
 
-// ========================== Variables de Juego ==========================
-
-// Variables para puntaje
-int puntaje = 0;         // Puntaje acumulado del jugador
-int puntos_totales = 0;  // Puntos necesarios para completar el nivel
+// Pedidos de memoria dinámica hechos por la carga de mapas, las arenas y la
+// caché de la escena (los informa --microbench; es atómico por los lotes en hilos)
+SDL_atomic_t asignaciones = {0};
 
 // ========================== Movimientos ==========================
 
@@ -107,474 +258,5349 @@ SDL_Color COLOR_FONDO = {0, 0, 0, 255};         // Negro para el fondo
 
 // ========================== Variables de Audio ==========================
 
-// Variables para controlar la reproducción del sonido
-int ultimaX = -1, ultimaY = -1; // Posiciones anteriores de Pac-Man
-Uint32 ultimoTiempoSonido = 0;  // Tiempo del último sonido reproducido
-Uint32 delaySonido = 100;       // Delay de 100 ms entre sonidos
+// Efectos de sonido del juego
+enum Sonido {
+    SONIDO_NINGUNO = -1,
+    SONIDO_COMER,               // Pac-Man come un punto
+    SONIDO_INICIO,              // Música de inicio del juego
+    SONIDO_MUERTE,              // Muerte de Pac-Man
+    CANT_SONIDOS
+};
 
-// Punteros a los efectos de sonido
-Mix_Chunk *pacmanSound = NULL;  // Sonido de comer puntos
-Mix_Chunk *inicioSound = NULL;  // Sonido de inicio del juego
-Mix_Chunk *muerteSound = NULL;  // Sonido de muerte de Pac-Man
+// Grupos de canales del mezclador: cada tipo de efecto tiene canales propios,
+// así un sonido largo nunca le quita el lugar a otro
+enum GrupoAudio {
+    GRUPO_EFECTOS,              // Sonidos cortos y frecuentes (comer)
+    GRUPO_MUSICA,               // Melodías de inicio y de muerte
+    CANT_GRUPOS
+};
 
+// Dónde se reproduce el audio
+enum BackendAudio {
+    AUDIO_SDL,                  // Dispositivo de audio del sistema, con SDL_mixer
+    AUDIO_NULO                  // Sin dispositivo: solo cuenta las reproducciones (--audio=nulo o si falla SDL_mixer)
+};
 
+// Muestras del búfer del mezclador (se cambia con --audio-buffer=N). Con 512
+// muestras a 44100 Hz el retardo es de unos 12 ms, en lugar de los 46 ms de 2048
+int muestras_audio = 512;
+
+// Backend de audio pedido por línea de comandos
+enum BackendAudio backend_audio = AUDIO_SDL;
+
+
+
+// ============================ Tabla de Saltos ============================
+// Tabla precalculada con el primer paso del camino más corto entre cada par
+// de celdas libres del mapa: con ella, el paso de un fantasma es una sola
+// lectura y no hace falta buscar caminos durante el juego. Ocupa un byte por
+// par de celdas libres, así que solo se arma (con --ia=tabla) si entra en el
+// límite de memoria; si no, los fantasmas buscan sus caminos con A*.
+// Cada fila es el campo de distancias hacia una celda de destino, así que
+// las filas se calculan en paralelo, repartidas entre todos los núcleos.
+typedef struct TablaSaltos {
+    int cantidad;               // Celdas libres del mapa (filas y columnas de la tabla)
+    int* numero;                // Número de celda libre de cada celda de la rejilla (-1 en las paredes)
+    int* celda;                 // Celda de la rejilla de cada número de celda libre
+    Uint8* direccion;           // direccion[destino * cantidad + origen]: primer paso desde el origen (NINGUNA si no hay)
+    size_t memoria;             // Bytes que ocupa la tabla
+    bool obsoleta;              // El mapa cambió después de armarla (ver mapa_cambiar_celda): ya no se consulta
+    bool en_pack;               // Los arreglos apuntan a la proyección del pack: no se liberan
+} TablaSaltos;
+
+// Indica si los mapas deben cargarse con su tabla de saltos (--ia=tabla)
+bool precalcular_saltos = false;
+
+// Indica si se informa cada tabla o jerarquía armada (el microbench lo apaga para no cortar su tabla)
+bool informar_precalculo = true;
+
+// Memoria máxima de una tabla de saltos en bytes (se cambia con --memoria-tabla=MB)
+size_t limite_tabla_saltos = 64 * 1024 * 1024;
+
+// Libera una tabla de saltos
+void saltos_liberar(TablaSaltos* tabla) {
+    if (tabla != NULL) {
+        if (!tabla->en_pack) {
+            free(tabla->numero);
+            free(tabla->celda);
+            free(tabla->direccion);
+        }
+        free(tabla);
+    }
+}
 
-// =========================== Función cargar_mapa ===========================
-// Función para cargar el mapa desde un archivo y contar los puntos
-// Recibe un puntero a Mapa (estructura que contiene el nombre del archivo, filas y columnas)
-int cargar_mapa(Mapa* mapa) {
-    // Abre el archivo de texto que contiene el diseño del mapa
-    FILE* file = fopen(mapa->nombre, "r");
-    if (!file) {
-        // Si no se pudo abrir el archivo, muestra un error y retorna -1
-        perror("No se pudo abrir el archivo de mapa");
+// Trabajo compartido por los hilos que arman una tabla
+typedef struct {
+    const Mapa* mapa;           // Mapa del que se arma la tabla
+    TablaSaltos* tabla;         // Tabla a completar
+    SDL_atomic_t siguiente;     // Próxima fila (celda de destino) sin calcular
+    SDL_atomic_t error;         // Distinto de 0 si a algún hilo le faltó memoria
+} ConstruccionSaltos;
+
+// Hilo que calcula filas de la tabla hasta que no queden: un BFS desde la
+// celda de destino y, para cada origen, el primer vecino un paso más cerca
+// (el mismo criterio que campo_siguiente_paso, así ambos modos mueven igual a los fantasmas)
+static int hilo_saltos(void* datos) {
+    ConstruccionSaltos* trabajo = datos;
+    const Mapa* mapa = trabajo->mapa;
+    TablaSaltos* tabla = trabajo->tabla;
+    const int desplazamiento[4] = {-mapa->paso, mapa->paso, -1, 1};
+
+    int celdas = mapa_celdas(mapa);
+    int* distancia = malloc(celdas * sizeof(int));
+    int* cola = malloc(tabla->cantidad * sizeof(int));
+    if (distancia == NULL || cola == NULL) {
+        free(distancia);
+        free(cola);
+        SDL_AtomicSet(&trabajo->error, 1);
         return -1;
     }
+    for (int i = 0; i < celdas; i++) {
+        distancia[i] = -1;
+    }
 
-    puntos_totales = 0; // Inicializa el contador de puntos
-
-    // Lee el archivo línea por línea y guarda el contenido en la matriz del mapa
-    for (int i = 0; i < mapa->filas; i++) {
-        // fgets lee una línea del archivo y la almacena en el arreglo correspondiente
-        if (fgets(mapa->maze[i], mapa->columnas + 2, file) == NULL) {
-            // Si hay un error al leer una línea, muestra un error, cierra el archivo y retorna -1
-            perror("Error al leer el mapa");
-            fclose(file);
-            return -1;
+    for (int destino = SDL_AtomicAdd(&trabajo->siguiente, 1); destino < tabla->cantidad;
+         destino = SDL_AtomicAdd(&trabajo->siguiente, 1)) {
+        // BFS desde el destino
+        int inicio = 0, fin = 0;
+        distancia[tabla->celda[destino]] = 0;
+        cola[fin++] = tabla->celda[destino];
+        while (inicio < fin) {
+            int actual = cola[inicio++];
+            unsigned int mascara = mapa->vecinos[actual];
+            for (int d = 0; d < 4; d++) {
+                int vecino = actual + desplazamiento[d];
+                if ((mascara & (1u << d)) && distancia[vecino] == -1) {
+                    distancia[vecino] = distancia[actual] + 1;
+                    cola[fin++] = vecino;
+                }
+            }
         }
 
-        // Cuenta el número de puntos ('.') en el mapa para calcular el puntaje total
-        for (int j = 0; j < mapa->columnas; j++) {
-            if (mapa->maze[i][j] == POINT) {
-                puntos_totales++;
+        // Primer paso desde cada origen hacia el destino
+        Uint8* fila = tabla->direccion + (size_t)destino * tabla->cantidad;
+        for (int origen = 0; origen < tabla->cantidad; origen++) {
+            int celda = tabla->celda[origen];
+            int d = distancia[celda];
+            fila[origen] = NINGUNA;
+            for (int k = 0; k < 4 && d > 0; k++) {
+                if ((mapa->vecinos[celda] & (1u << k)) && distancia[celda + desplazamiento[k]] == d - 1) {
+                    fila[origen] = (Uint8)k;
+                    break;
+                }
             }
         }
-    }
 
-    fclose(file); // Cierra el archivo después de cargar el mapa
-    return 0; // Retorna 0 si se cargó correctamente
+        // Deja la rejilla de distancias limpia para la próxima fila (solo las celdas visitadas)
+        for (int i = 0; i < fin; i++) {
+            distancia[cola[i]] = -1;
+        }
+    }
+    free(distancia);
+    free(cola);
+    return 0;
 }
 
-
-
-// =========================== Función cargar_sonido ===========================
-// Función para cargar los efectos de sonido utilizando SDL_mixer
-void cargar_sonido() {
-    // Inicializa SDL_mixer con frecuencia de audio de 44100 Hz, formato de audio predeterminado
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        printf("Error al inicializar SDL_mixer: %s\n", Mix_GetError());
+// ===================== Función saltos_construir =====================
+// Arma la tabla de saltos del mapa si entra en el límite de memoria, e
+// informa por consola cuánto tardó y cuánta memoria ocupa
+// Retorna: 0 si el mapa quedó con su tabla o -1 si se usará la búsqueda en línea
+int saltos_construir(Mapa* mapa) {
+    Uint64 inicio = SDL_GetPerformanceCounter();
+    saltos_liberar(mapa->saltos);
+    mapa->saltos = NULL;
+
+    // Cuenta las celdas libres y estima la memoria antes de reservar nada
+    int celdas = mapa_celdas(mapa), cantidad = 0;
+    for (int i = 0; i < celdas; i++) {
+        cantidad += !mapa_es_pared(mapa, i) && i % mapa->paso < mapa->columnas;
     }
-
-    // Carga el sonido de Pac-Man al comer
-    pacmanSound = Mix_LoadWAV("pacman_chomp.wav");
-    if (pacmanSound == NULL) {
-        printf("Error al cargar el sonido: %s\n", Mix_GetError());
+    size_t memoria = sizeof(TablaSaltos) + (size_t)cantidad * cantidad + ((size_t)celdas + cantidad) * sizeof(int);
+    if (memoria > limite_tabla_saltos) {
+        if (informar_precalculo) {
+            printf("Tabla de saltos de %s: necesita %.1f MB y el límite es %.1f MB; los fantasmas usan A*\n",
+                   mapa->nombre, memoria / 1048576.0, limite_tabla_saltos / 1048576.0);
+        }
+        return -1;
     }
 
-    // Carga el sonido de inicio del juego
-    inicioSound = Mix_LoadWAV("Inicio.wav");
-    if (inicioSound == NULL) {
-        printf("Error al cargar el sonido: %s\n", Mix_GetError());
+    TablaSaltos* tabla = calloc(1, sizeof(TablaSaltos));
+    if (tabla != NULL) {
+        tabla->cantidad = cantidad;
+        tabla->memoria = memoria;
+        tabla->numero = malloc(celdas * sizeof(int));
+        tabla->celda = malloc((cantidad > 0 ? cantidad : 1) * sizeof(int));
+        tabla->direccion = malloc(cantidad > 0 ? (size_t)cantidad * cantidad : 1);
     }
-
-    // Carga el sonido de la muerte de Pac-Man
-    muerteSound = Mix_LoadWAV("Muerte.wav");
-    if (muerteSound == NULL) {
-        printf("Error al cargar el sonido: %s\n", Mix_GetError());
+    if (tabla == NULL || !tabla->numero || !tabla->celda || !tabla->direccion) {
+        printf("Tabla de saltos de %s: no hay memoria; los fantasmas usan A*\n", mapa->nombre);
+        saltos_liberar(tabla);
+        return -1;
     }
-}
-
-
-
-// ====================== Función reproducir_y_liberar_sonido ======================
-// Función para reproducir un efecto de sonido y liberar el recurso si se especifica
-// Recibe el sonido a reproducir, un booleano para indicar si se debe esperar (delay) y la duración del delay
-void reproducir_y_liberar_sonido(Mix_Chunk *Sonido, bool delay, int Duracion_delay) {
-    if (Sonido != NULL) {
-        // Reproduce el sonido en el canal -1 (primer canal disponible)
-        Mix_PlayChannel(-1, Sonido, 0);
-
-        // Si se especifica, espera la duración indicada y libera el recurso de sonido
-        if (delay) {
-            SDL_Delay(Duracion_delay);   // Espera la duración del sonido
-            Mix_FreeChunk(Sonido);       // Libera el recurso de sonido
+    for (int i = 0, n = 0; i < celdas; i++) {
+        bool libre = !mapa_es_pared(mapa, i) && i % mapa->paso < mapa->columnas;
+        tabla->numero[i] = libre ? n : -1;
+        if (libre) {
+            tabla->celda[n++] = i;
         }
     }
-}
-
-
 
-// ========================= Función mostrar_mensaje =========================
-// Función para mostrar un mensaje de texto en pantalla, centrado
-// Recibe el mapa, el mensaje de texto, y el color del texto
-void mostrar_mensaje(Mapa* mapa, const char* mensaje, SDL_Color color) {
-    // Inicializa SDL_ttf para manejo de fuentes y verifica errores
-    if (TTF_Init() == -1) {
-        printf("Error al inicializar SDL_ttf: %s\n", TTF_GetError());
-        return;
+    // Reparte las filas entre un hilo por núcleo (el hilo actual también trabaja)
+    ConstruccionSaltos trabajo = {mapa, tabla, {0}, {0}};
+    int cant_hilos = SDL_GetCPUCount();
+    if (cant_hilos > cantidad) {
+        cant_hilos = cantidad;
     }
-
-    // Carga la fuente desde el archivo .ttf con un tamaño de 64 puntos
-    TTF_Font* font = TTF_OpenFont("Letras.ttf", 64);
-    if (!font) {
-        printf("Error al cargar la fuente: %s\n", TTF_GetError());
-        return;
+    if (cant_hilos < 1) {
+        cant_hilos = 1;
     }
-
-    // Crea una superficie con el texto renderizado de forma sólida
-    SDL_Surface* surfaceMessage = TTF_RenderText_Solid(font, mensaje, color);
-    if (!surfaceMessage) {
-        printf("Error al crear la superficie de texto: %s\n", TTF_GetError());
-        TTF_CloseFont(font);
-        TTF_Quit();
-        return;
+    SDL_Thread* hilos[64] = {NULL};
+    int cant_extra = cant_hilos - 1 < 64 ? cant_hilos - 1 : 64;
+    for (int h = 0; h < cant_extra; h++) {
+        hilos[h] = SDL_CreateThread(hilo_saltos, "saltos", &trabajo);
+    }
+    hilo_saltos(&trabajo);
+    for (int h = 0; h < cant_extra; h++) {
+        SDL_WaitThread(hilos[h], NULL);
+    }
+    if (SDL_AtomicGet(&trabajo.error) != 0) {
+        printf("Tabla de saltos de %s: no hay memoria; los fantasmas usan A*\n", mapa->nombre);
+        saltos_liberar(tabla);
+        return -1;
     }
 
-    // Convierte la superficie de texto a una textura para renderizarla
-    SDL_Texture* message = SDL_CreateTextureFromSurface(renderer, surfaceMessage);
-    SDL_FreeSurface(surfaceMessage); // Libera la superficie ya que no se necesita más
+    mapa->saltos = tabla;
+    if (informar_precalculo) {
+        printf("Tabla de saltos de %s: %d celdas libres, %.1f KB, %.2f ms con %d hilo%s\n",
+               mapa->nombre, cantidad, memoria / 1024.0,
+               (double)(SDL_GetPerformanceCounter() - inicio) * 1000.0 / (double)SDL_GetPerformanceFrequency(),
+               cant_extra + 1, cant_extra > 0 ? "s" : "");
+    }
+    return 0;
+}
 
-    // Calcula el tamaño y posición del texto para centrarlo en pantalla
-    int text_width, text_height;
-    TTF_SizeText(font, mensaje, &text_width, &text_height);
-    SDL_Rect textRect = { 
-        ((mapa->columnas * TILE_SIZE) - text_width) / 2,  // Posición X centrada
-        (mapa->filas * TILE_SIZE) / 2,                    // Posición Y centrada
-        text_width, 
-        text_height 
-    };
+// Primer paso desde "origen" hacia "destino" según la tabla (el mismo origen si no hay camino).
+// Una tabla leída de un pack no se recorre entera al cargarla, así que se
+// descartan los números y las direcciones que no corresponden al mapa
+static inline Posicion saltos_siguiente_paso(const TablaSaltos* tabla, const VistaMapa* vista, Posicion origen, Posicion destino) {
+    int celda_origen = origen.y * vista->paso + origen.x;
+    int numero_origen = tabla->numero[celda_origen];
+    int numero_destino = tabla->numero[destino.y * vista->paso + destino.x];
+    if ((unsigned)numero_origen >= (unsigned)tabla->cantidad || (unsigned)numero_destino >= (unsigned)tabla->cantidad) {
+        return origen;
+    }
+    Uint8 direccion = tabla->direccion[(size_t)numero_destino * tabla->cantidad + numero_origen];
+    if (direccion >= NINGUNA || !(vista->vecinos[celda_origen] & (1u << direccion))) {
+        return origen;
+    }
+    return (Posicion){origen.x + direcciones[direccion].x, origen.y + direcciones[direccion].y};
+}
 
-    // Limpia la pantalla y establece el color de fondo a negro
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
 
-    // Renderiza el texto en pantalla
-    SDL_RenderCopy(renderer, message, NULL, &textRect);
-    SDL_RenderPresent(renderer); // Muestra el renderizado en pantalla
 
-    SDL_Delay(2000); // Pausa la pantalla por 2 segundos para que el mensaje sea visible
+// ========================== Jerarquía de Clusters ==========================
+// Grafo abstracto para la búsqueda jerárquica (HPA*, --ia=hpa). El mapa se
+// divide en clusters de TAMANO_CLUSTER x TAMANO_CLUSTER celdas; en cada borde
+// entre dos clusters, cada tramo de celdas libres enfrentadas es una entrada
+// con un nodo a cada lado (uno en el medio del tramo, o uno en cada punta si
+// el tramo es largo). Al cargar el mapa se calcula, dentro de cada cluster, la
+// distancia entre cada par de sus nodos. Una búsqueda recorre ese grafo, que
+// tiene muchos menos nodos que celdas el mapa, y solo busca celda por celda
+// dentro del cluster en que está el fantasma (ver Búsqueda Jerárquica).
+// Cada cluster depende solo de sus celdas y de las de sus bordes, así que si
+// cambia una celda alcanza con rehacer su cluster y los vecinos que comparten
+// ese borde (ver mapa_cambiar_celda).
+#define TAMANO_CLUSTER 16                               // Celdas por lado de un cluster
+#define MAX_ENTRADAS_LADO (TAMANO_CLUSTER / 2)          // Tramos separados por paredes que caben en un lado
+#define MAX_NODOS_CLUSTER (4 * MAX_ENTRADAS_LADO)       // Nodos de un cluster como máximo
+#define LARGO_ENTRADA_DOBLE 6                           // Desde este largo, un tramo tiene un nodo en cada punta
+#define SIN_CAMINO_CLUSTER 0xFFFF                       // Distancia entre nodos que no se conectan dentro del cluster
+
+// Nodos de un cluster y distancias entre ellos sin salir del cluster
+typedef struct {
+    int cantidad;                                           // Nodos del cluster
+    int celdas[MAX_NODOS_CLUSTER];                          // Celda del mapa de cada nodo
+    Uint8 lados[MAX_NODOS_CLUSTER];                         // Dirección en la que el nodo sale del cluster
+    Uint16 distancias[MAX_NODOS_CLUSTER][MAX_NODOS_CLUSTER]; // Pasos entre cada par de nodos (SIN_CAMINO_CLUSTER si no se conectan)
+} Cluster;
+
+typedef struct Jerarquia {
+    int clusters_x, clusters_y;     // Clusters por fila y por columna
+    int columnas, filas, paso;      // Dimensiones del mapa
+    Cluster* clusters;              // clusters[cy * clusters_x + cx]
+    size_t memoria;                 // Bytes que ocupa la jerarquía
+    Uint32 version;                 // Aumenta con cada mapa_cambiar_celda (invalida los BFS locales guardados)
+    bool en_pack;                   // Los clusters apuntan a la proyección del pack: no se liberan
+} Jerarquia;
+
+// Indica si los mapas deben cargarse con su jerarquía de clusters (--ia=hpa)
+bool precalcular_jerarquia = false;
+
+void jerarquia_liberar(Jerarquia* jerarquia) {
+    if (jerarquia != NULL) {
+        if (!jerarquia->en_pack) {
+            free(jerarquia->clusters);
+        }
+        free(jerarquia);
+    }
+}
 
-    // Libera los recursos utilizados
-    SDL_DestroyTexture(message);
-    TTF_CloseFont(font);
-    TTF_Quit();
+// Cluster que contiene la celda con el índice dado
+static inline int jerarquia_cluster(const Jerarquia* j, int celda) {
+    return (celda / j->paso / TAMANO_CLUSTER) * j->clusters_x + (celda % j->paso) / TAMANO_CLUSTER;
 }
 
+// Posición de una celda dentro de su cluster (0 a TAMANO_CLUSTER² - 1)
+static inline int jerarquia_local(const Jerarquia* j, int celda) {
+    return (celda / j->paso % TAMANO_CLUSTER) * TAMANO_CLUSTER + (celda % j->paso) % TAMANO_CLUSTER;
+}
 
+// Esquina y tamaño del cluster de una celda (los del borde derecho e inferior pueden ser más chicos)
+static inline void jerarquia_limites(const Jerarquia* j, int celda, int* x0, int* y0, int* ancho, int* alto) {
+    *x0 = celda % j->paso / TAMANO_CLUSTER * TAMANO_CLUSTER;
+    *y0 = celda / j->paso / TAMANO_CLUSTER * TAMANO_CLUSTER;
+    *ancho = SDL_min(TAMANO_CLUSTER, j->columnas - *x0);
+    *alto = SDL_min(TAMANO_CLUSTER, j->filas - *y0);
+}
 
+// Indica si desde la posición local (lx, ly) se puede dar un paso en la dirección d sin salir del cluster
+static inline bool cluster_adentro(int d, int lx, int ly, int ancho, int alto) {
+    return d == ARRIBA ? ly > 0 : d == ABAJO ? ly < alto - 1 : d == IZQUIERDA ? lx > 0 : lx < ancho - 1;
+}
 
-// =========================== Función iniciar_SDL ===========================
-// Función para inicializar SDL y crear la ventana y el renderizador
-// Recibe un parámetro "mapa" de tipo Mapa para ajustar el tamaño de la ventana
-int iniciar_SDL(Mapa mapa) {
-    
-    // Inicializar SDL con el subsistema de video
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        // Si falla la inicialización, muestra el error y retorna -1
-        printf("Error al iniciar SDL: %s\n", SDL_GetError());
-        return -1;
+// ===================== Función cluster_bfs =====================
+// BFS desde una celda sin salir de su cluster. Deja en "distancia" (indexada
+// con jerarquia_local) los pasos desde cada celda del cluster, o -1 si no se
+// llega. Trabaja con posiciones locales, así que no divide en cada celda
+// Retorna: la cantidad de celdas visitadas
+int cluster_bfs(const Jerarquia* j, const Uint8* vecinos, int inicio, int* distancia, int* cola) {
+    int x0, y0, ancho, alto;
+    jerarquia_limites(j, inicio, &x0, &y0, &ancho, &alto);
+    int base = y0 * j->paso + x0;
+    const int local[4] = {-TAMANO_CLUSTER, TAMANO_CLUSTER, -1, 1};
+    for (int i = 0; i < TAMANO_CLUSTER * TAMANO_CLUSTER; i++) {
+        distancia[i] = -1;
     }
+    int desde = 0, hasta = 0;
+    cola[hasta] = jerarquia_local(j, inicio);
+    distancia[cola[hasta++]] = 0;
+    while (desde < hasta) {
+        int actual = cola[desde++];
+        int lx = actual % TAMANO_CLUSTER, ly = actual / TAMANO_CLUSTER;
+        unsigned int mascara = vecinos[base + ly * j->paso + lx];
+        for (int d = 0; d < 4; d++) {
+            if ((mascara & (1u << d)) && cluster_adentro(d, lx, ly, ancho, alto) && distancia[actual + local[d]] == -1) {
+                distancia[actual + local[d]] = distancia[actual] + 1;
+                cola[hasta++] = actual + local[d];
+            }
+        }
+    }
+    return hasta;
+}
 
-    // Crear una ventana para el juego Pac-Man con las dimensiones basadas en el mapa
-    window = SDL_CreateWindow(
-        "Pacman con SDL2",               // Título de la ventana
-        SDL_WINDOWPOS_UNDEFINED,         // Posición X de la ventana (centrada)
-        SDL_WINDOWPOS_UNDEFINED,         // Posición Y de la ventana (centrada)
-        mapa.columnas * TILE_SIZE,       // Ancho de la ventana (columnas * tamaño de celda)
-        mapa.filas * TILE_SIZE,          // Alto de la ventana (filas * tamaño de celda)
-        SDL_WINDOW_SHOWN                 // Mostrar ventana al crearla
-    );
-
-    // Verificar si la ventana se creó correctamente
-    if (!window) {
-        // Si falla la creación de la ventana, muestra el error, cierra SDL y retorna -1
-        printf("Error al crear la ventana: %s\n", SDL_GetError());
-        SDL_Quit();
+// Celda vecina de "celda" que baja un paso por el campo de un BFS local de su
+// mismo cluster, o -1 si la celda es el origen del BFS o no llega a él
+static int cluster_bajar(const Jerarquia* j, const Uint8* vecinos, const int* distancia, int celda) {
+    int actual = jerarquia_local(j, celda);
+    if (distancia[actual] <= 0) {
         return -1;
     }
+    int x0, y0, ancho, alto;
+    jerarquia_limites(j, celda, &x0, &y0, &ancho, &alto);
+    int lx = actual % TAMANO_CLUSTER, ly = actual / TAMANO_CLUSTER;
+    const int local[4] = {-TAMANO_CLUSTER, TAMANO_CLUSTER, -1, 1};
+    const int desplazamiento[4] = {-j->paso, j->paso, -1, 1};
+    for (int d = 0; d < 4; d++) {
+        if ((vecinos[celda] & (1u << d)) && cluster_adentro(d, lx, ly, ancho, alto) &&
+            distancia[actual + local[d]] == distancia[actual] - 1) {
+            return celda + desplazamiento[d];
+        }
+    }
+    return -1;
+}
 
-    // Crear el renderizador para dibujar en la ventana
-    renderer = SDL_CreateRenderer(
-        window,                          // Ventana asociada
-        -1,                              // Índice del driver (-1 para usar el primero disponible)
-        SDL_RENDERER_ACCELERATED         // Utilizar renderizado acelerado por hardware
-    );
+// Entradas de un lado de un cluster: agrega a "celdas" las celdas del cluster
+// (del lado "lado") que tienen un nodo. El cluster de enfrente recorre el mismo
+// borde en el mismo orden, así que siempre coincide con las suyas
+static int cluster_entradas(const Mapa* mapa, const Jerarquia* j, int cluster, int lado, int* celdas) {
+    int cx = cluster % j->clusters_x, cy = cluster / j->clusters_x;
+    int x0 = cx * TAMANO_CLUSTER, y0 = cy * TAMANO_CLUSTER;
+    int x1 = SDL_min(x0 + TAMANO_CLUSTER, mapa->columnas), y1 = SDL_min(y0 + TAMANO_CLUSTER, mapa->filas);
+
+    // Celdas del borde recorridas en orden: fila o columna fija, según el lado
+    int fijo = lado == ARRIBA ? y0 : lado == ABAJO ? y1 - 1 : lado == IZQUIERDA ? x0 : x1 - 1;
+    bool horizontal = lado == ARRIBA || lado == ABAJO;
+    int desde = horizontal ? x0 : y0, hasta = horizontal ? x1 : y1;
+
+    int cantidad = 0, tramo = -1; // tramo: comienzo del tramo abierto actual (-1 si no hay)
+    for (int k = desde; k <= hasta; k++) {
+        bool abierta = false;
+        if (k < hasta) {
+            int celda = horizontal ? mapa_indice(mapa, k, fijo) : mapa_indice(mapa, fijo, k);
+            // La celda y la de enfrente son libres (la tabla de vecinos descarta el borde del mapa)
+            abierta = !mapa_es_pared(mapa, celda) && (mapa->vecinos[celda] & (1u << lado));
+        }
+        if (abierta && tramo == -1) {
+            tramo = k;
+        } else if (!abierta && tramo != -1) {
+            int largo = k - tramo;
+            int puntas[2] = {tramo + (largo - 1) / 2, -1};
+            if (largo >= LARGO_ENTRADA_DOBLE) {
+                puntas[0] = tramo;
+                puntas[1] = k - 1;
+            }
+            for (int p = 0; p < 2 && puntas[p] != -1; p++) {
+                celdas[cantidad++] = horizontal ? mapa_indice(mapa, puntas[p], fijo) : mapa_indice(mapa, fijo, puntas[p]);
+            }
+            tramo = -1;
+        }
+    }
+    return cantidad;
+}
 
-    // Verificar si el renderizador se creó correctamente
-    if (!renderer) {
-        // Si falla la creación del renderizador, muestra el error, destruye la ventana, cierra SDL y retorna -1
-        printf("Error al crear el renderizador: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window);       // Destruir la ventana creada previamente
-        SDL_Quit();                      // Cerrar SDL
-        return -1;
+// =================== Función cluster_construir ===================
+// Arma los nodos de un cluster a partir de sus cuatro bordes y las distancias
+// entre ellos (un BFS dentro del cluster desde cada nodo)
+static void cluster_construir(const Mapa* mapa, Jerarquia* j, int cluster, int* distancia, int* cola) {
+    Cluster* c = &j->clusters[cluster];
+    c->cantidad = 0;
+    for (int lado = 0; lado < 4; lado++) {
+        int celdas[MAX_ENTRADAS_LADO];
+        int cantidad = cluster_entradas(mapa, j, cluster, lado, celdas);
+        for (int k = 0; k < cantidad; k++) {
+            c->celdas[c->cantidad] = celdas[k];
+            c->lados[c->cantidad++] = (Uint8)lado;
+        }
+    }
+    for (int a = 0; a < c->cantidad; a++) {
+        cluster_bfs(j, mapa->vecinos, c->celdas[a], distancia, cola);
+        for (int b = 0; b < c->cantidad; b++) {
+            int d = distancia[jerarquia_local(j, c->celdas[b])];
+            c->distancias[a][b] = d == -1 ? SIN_CAMINO_CLUSTER : (Uint16)d;
+        }
     }
+}
 
-    // Si todo se inicializó correctamente, retorna 0
+// Trabajo compartido por los hilos que arman una jerarquía
+typedef struct {
+    const Mapa* mapa;
+    Jerarquia* jerarquia;
+    SDL_atomic_t siguiente;     // Próximo cluster sin armar
+} ConstruccionJerarquia;
+
+// Hilo que arma clusters hasta que no queden (son independientes entre sí)
+static int hilo_jerarquia(void* datos) {
+    ConstruccionJerarquia* trabajo = datos;
+    Jerarquia* j = trabajo->jerarquia;
+    int distancia[TAMANO_CLUSTER * TAMANO_CLUSTER], cola[TAMANO_CLUSTER * TAMANO_CLUSTER];
+    int total = j->clusters_x * j->clusters_y;
+    for (int c = SDL_AtomicAdd(&trabajo->siguiente, 1); c < total; c = SDL_AtomicAdd(&trabajo->siguiente, 1)) {
+        cluster_construir(trabajo->mapa, j, c, distancia, cola);
+    }
     return 0;
 }
 
+// ==================== Función jerarquia_construir ====================
+// Arma la jerarquía de clusters del mapa, repartiendo los clusters entre
+// todos los núcleos, e informa por consola cuánto tardó y cuánto ocupa
+// Retorna: 0 si el mapa quedó con su jerarquía o -1 si se usará A*
+int jerarquia_construir(Mapa* mapa) {
+    Uint64 inicio = SDL_GetPerformanceCounter();
+    jerarquia_liberar(mapa->jerarquia);
+    mapa->jerarquia = NULL;
+
+    Jerarquia* j = calloc(1, sizeof(Jerarquia));
+    if (j != NULL) {
+        j->clusters_x = (mapa->columnas + TAMANO_CLUSTER - 1) / TAMANO_CLUSTER;
+        j->clusters_y = (mapa->filas + TAMANO_CLUSTER - 1) / TAMANO_CLUSTER;
+        j->columnas = mapa->columnas;
+        j->filas = mapa->filas;
+        j->paso = mapa->paso;
+        j->memoria = sizeof(Jerarquia) + (size_t)j->clusters_x * j->clusters_y * sizeof(Cluster);
+        j->clusters = calloc((size_t)j->clusters_x * j->clusters_y, sizeof(Cluster)); // En cero: el pack guarda los clusters tal cual
+    }
+    if (j == NULL || j->clusters == NULL) {
+        printf("Jerarquía de %s: no hay memoria; los fantasmas usan A*\n", mapa->nombre);
+        jerarquia_liberar(j);
+        return -1;
+    }
 
+    // Reparte los clusters entre un hilo por núcleo (el hilo actual también trabaja)
+    ConstruccionJerarquia trabajo = {mapa, j, {0}};
+    int total = j->clusters_x * j->clusters_y;
+    int cant_hilos = SDL_GetCPUCount();
+    if (cant_hilos > total) {
+        cant_hilos = total;
+    }
+    if (cant_hilos < 1) {
+        cant_hilos = 1;
+    }
+    SDL_Thread* hilos[64] = {NULL};
+    int cant_extra = cant_hilos - 1 < 64 ? cant_hilos - 1 : 64;
+    for (int h = 0; h < cant_extra; h++) {
+        hilos[h] = SDL_CreateThread(hilo_jerarquia, "jerarquia", &trabajo);
+    }
+    hilo_jerarquia(&trabajo);
+    for (int h = 0; h < cant_extra; h++) {
+        SDL_WaitThread(hilos[h], NULL);
+    }
 
-// ======================= Función dibujar_rectangulo =======================
-// Función para dibujar un rectángulo en la posición especificada con un color dado
-// Parámetros:
-//   x, y: Coordenadas del rectángulo en el mapa
-//   porcentaje: Tamaño del rectángulo como un porcentaje del tamaño de una celda (TILE_SIZE)
-//   color: Color del rectángulo (estructura SDL_Color)
-void dibujar_rectangulo(int x, int y, int porcentaje, SDL_Color color) {
-    // Establece el color para el renderizador
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-
-    // Calcula el tamaño del rectángulo basado en el porcentaje
-    int size = (TILE_SIZE * porcentaje) / 100; 
-    int offset = (TILE_SIZE - size) / 2; // Calcula el desplazamiento para centrar el rectángulo
-
-    // Define el rectángulo a dibujar
-    SDL_Rect rect = {x * TILE_SIZE + offset, y * TILE_SIZE + offset, size, size};
-
-    // Dibuja el rectángulo relleno
-    SDL_RenderFillRect(renderer, &rect);
+    int nodos = 0;
+    for (int c = 0; c < total; c++) {
+        nodos += j->clusters[c].cantidad;
+    }
+    mapa->jerarquia = j;
+    if (informar_precalculo) {
+        printf("Jerarquía de %s: %d clusters, %d nodos, %.1f KB, %.2f ms con %d hilo%s\n",
+               mapa->nombre, total, nodos, j->memoria / 1024.0,
+               (double)(SDL_GetPerformanceCounter() - inicio) * 1000.0 / (double)SDL_GetPerformanceFrequency(),
+               cant_extra + 1, cant_extra > 0 ? "s" : "");
+    }
+    return 0;
 }
 
+// ===================== Función mapa_cambiar_celda =====================
+// Cambia el contenido de una celda de un mapa cargado (OBSTACLE, PATH o
+// POINT) y actualiza la máscara de paredes, la tabla de vecinos y, solo
+// alrededor de la celda, la jerarquía: se rehacen su cluster y los clusters
+// con los que comparte un borde si la celda está en ese borde. La tabla de
+// saltos no se puede actualizar por partes, así que se marca como obsoleta:
+// las partidas en curso la comparten, de modo que se libera recién al
+// descargar el nivel, y mientras tanto sus fantasmas usan el campo de
+// distancias. No cambia el índice de puntos del nivel, y los mapas de un pack
+// son de solo lectura.
+// Retorna: 0 si se cambió o -1 si el mapa es de solo lectura
+int mapa_cambiar_celda(Mapa* mapa, int x, int y, char contenido) {
+    if (mapa->nivel_pack != NULL || x < 0 || x >= mapa->columnas || y < 0 || y >= mapa->filas) {
+        return -1;
+    }
+    int celda = mapa_indice(mapa, x, y);
+    mapa->celdas[celda] = contenido;
+    mapa->cambios++; // El próximo cargar_mapa vuelve a leer el archivo
+    if (contenido == OBSTACLE) {
+        mapa->paredes[celda >> 6] |= (Uint64)1 << (celda & 63);
+    } else {
+        mapa->paredes[celda >> 6] &= ~((Uint64)1 << (celda & 63));
+    }
 
+    // La celda y sus cuatro vecinas: bit d de cada una según la celda de enfrente
+    for (int k = -1; k < 4; k++) {
+        int cx = k < 0 ? x : x + direcciones[k].x, cy = k < 0 ? y : y + direcciones[k].y;
+        if (cx < 0 || cx >= mapa->columnas || cy < 0 || cy >= mapa->filas) {
+            continue;
+        }
+        Uint8 mascara = 0;
+        for (int d = 0; d < 4; d++) {
+            int vx = cx + direcciones[d].x, vy = cy + direcciones[d].y;
+            if (vx >= 0 && vx < mapa->columnas && vy >= 0 && vy < mapa->filas && !mapa_es_pared(mapa, mapa_indice(mapa, vx, vy))) {
+                mascara |= 1 << d;
+            }
+        }
+        mapa->vecinos[mapa_indice(mapa, cx, cy)] = mascara;
+    }
 
-// ========================= Función dibujar_juego =========================
-// Función para dibujar el mapa, Pac-Man, los fantasmas y contar puntos
-void dibujar_juego(Mapa* mapa, Posicion* pacman, Posicion ghost, Posicion ghost2, Posicion ghost3) {
-    // Limpia la pantalla y establece el color de fondo a negro
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Obtiene el tiempo actual para futuras animaciones (aunque aquí no se utiliza)
-    Uint32 tiempoActual = SDL_GetTicks();
+    if (mapa->saltos != NULL) {
+        mapa->saltos->obsoleta = true;
+    }
 
-    // Itera sobre las filas y columnas del mapa
-    for (int i = 0; i < mapa->filas; i++) {
-        for (int j = 0; j < mapa->columnas; j++) {
-            switch (mapa->maze[i][j]) {
-                case OBSTACLE:
-                    // Dibuja un obstáculo (bloque) en el mapa
-                    dibujar_rectangulo(j, i, 100, COLOR_OBSTACLE);
-                    break;
-                case POINT:
-                    // Si Pac-Man está en la posición del punto, elimina el punto
-                    if (pacman->x == j && pacman->y == i) {
-                        mapa->maze[i][j] = PATH; // Marca la celda como vacía
-                    } else {
-                        // Dibuja el punto con un tamaño más pequeño (10% de la celda)
-                        dibujar_rectangulo(j, i, 10, COLOR_POINT);
-                    }
-                    break;
-                default:
-                    break;
+    if (mapa->jerarquia != NULL) {
+        // Su cluster y, si la celda está en un borde, el cluster de enfrente
+        Jerarquia* j = mapa->jerarquia;
+        int distancia[TAMANO_CLUSTER * TAMANO_CLUSTER], cola[TAMANO_CLUSTER * TAMANO_CLUSTER];
+        j->version++;
+        cluster_construir(mapa, j, jerarquia_cluster(j, celda), distancia, cola);
+        for (int d = 0; d < 4; d++) {
+            int vx = x + direcciones[d].x, vy = y + direcciones[d].y;
+            if (vx >= 0 && vx < mapa->columnas && vy >= 0 && vy < mapa->filas &&
+                jerarquia_cluster(j, mapa_indice(mapa, vx, vy)) != jerarquia_cluster(j, celda)) {
+                cluster_construir(mapa, j, jerarquia_cluster(j, mapa_indice(mapa, vx, vy)), distancia, cola);
             }
         }
     }
+    return 0;
+}
 
-    // Dibuja a Pac-Man con un tamaño del 85% de la celda
-    dibujar_rectangulo(pacman->x, pacman->y, 85, COLOR_PACMAN);
 
-    // Dibuja los tres fantasmas con un tamaño del 75% de la celda
-    dibujar_rectangulo(ghost.x, ghost.y, 75, COLOR_GHOST);
-    dibujar_rectangulo(ghost2.x, ghost2.y, 75, COLOR_GHOST);
-    dibujar_rectangulo(ghost3.x, ghost3.y, 75, COLOR_GHOST);
+// =========================== Formato de los Mapas ===========================
+// Cada archivo de mapa empieza con un encabezado que describe el mapa:
+//
+//     MAPA <columnas> <filas> <puntos>
+//
+// seguido de <filas> líneas de <columnas> caracteres: '#' pared, '.' punto,
+// ' ' camino libre, 'C' posición inicial de Pac-Man y 'G', 'H', 'I' las de
+// cada fantasma (las posiciones iniciales son celdas de camino libre).
+// También se aceptan archivos sin encabezado (el formato anterior): el tamaño
+// se deduce de las líneas y se usan las posiciones iniciales de siempre.
+
+#define ENCABEZADO_MAPA "MAPA"
+
+// Libera la memoria de un mapa cargado (conserva el nombre del archivo)
+// Los mapas de un pack apuntan a la proyección del archivo y no se liberan
+void mapa_liberar(Mapa* mapa) {
+    saltos_liberar(mapa->saltos);
+    mapa->saltos = NULL;
+    jerarquia_liberar(mapa->jerarquia);
+    mapa->jerarquia = NULL;
+    if (mapa->nivel_pack == NULL) {
+        free(mapa->celdas);
+        free(mapa->paredes);
+        free(mapa->puntos);
+        free(mapa->vecinos);
+    }
+    mapa->celdas = NULL;
+    mapa->paredes = NULL;
+    mapa->puntos = NULL;
+    mapa->vecinos = NULL;
+    mapa->columnas = mapa->filas = mapa->paso = mapa->puntos_totales = 0;
+    mapa->cambios = 0;
+}
 
-    // Muestra el renderizado en pantalla
-    SDL_RenderPresent(renderer);
+// Asegura que un arreglo dinámico tenga lugar para "necesarios" elementos
+// (la capacidad se duplica, en size_t, sin pasar de SDL_MAX_SINT32)
+// Retorna: false si no hay memoria o "necesarios" no entra en un int
+static bool asegurar_capacidad(void** arreglo, int* capacidad, int necesarios, size_t tamano_elemento) {
+    if (necesarios <= *capacidad) {
+        return true;
+    }
+    if (necesarios < 0) {
+        return false;
+    }
+    size_t nueva = *capacidad > 0 ? (size_t)*capacidad : 64;
+    while (nueva < (size_t)necesarios) {
+        nueva *= 2;
+    }
+    if (nueva > SDL_MAX_SINT32) {
+        nueva = SDL_MAX_SINT32;
+    }
+    if (nueva > SIZE_MAX / tamano_elemento) {
+        return false;
+    }
+    void* nuevo = realloc(*arreglo, nueva * tamano_elemento);
+    if (nuevo == NULL) {
+        return false;
+    }
+    SDL_AtomicIncRef(&asignaciones);
+    *arreglo = nuevo;
+    *capacidad = (int)nueva;
+    return true;
 }
 
+// =================== Función calcular_vecinos ===================
+// Arma la tabla de vecinos de un mapa a partir de su máscara de paredes: para
+// cada celda, el bit d (en el orden de "direcciones") queda encendido si la
+// celda vecina en esa dirección está dentro del mapa y no es una pared. Así
+// la búsqueda de caminos recorre vecinos sin comprobar bordes ni paredes.
+// Retorna: la tabla (filas * paso bytes; el relleno queda en 0) o NULL si no hay memoria
+Uint8* calcular_vecinos(const Uint64* paredes, int columnas, int filas, int paso) {
+    Uint8* vecinos = calloc((size_t)filas * paso, 1);
+    if (vecinos == NULL) {
+        return NULL;
+    }
+    SDL_AtomicIncRef(&asignaciones);
+    for (int y = 0; y < filas; y++) {
+        for (int x = 0; x < columnas; x++) {
+            Uint8 mascara = 0;
+            for (int d = 0; d < 4; d++) {
+                int vx = x + direcciones[d].x, vy = y + direcciones[d].y;
+                int indice = vy * paso + vx;
+                if (vx >= 0 && vx < columnas && vy >= 0 && vy < filas &&
+                    !((paredes[indice >> 6] >> (indice & 63)) & 1)) {
+                    mascara |= 1 << d;
+                }
+            }
+            vecinos[y * paso + x] = mascara;
+        }
+    }
+    return vecinos;
+}
 
 
-// ======================= Función Animacion_Muerte =======================
-// Función para mostrar la animación de la muerte de Pac-Man
-void Animacion_Muerte(Mapa* mapa, Posicion pacman, Posicion ghost, Posicion ghost2, Posicion ghost3) {
+// ============================ Packs de Niveles ============================
+// Un pack reúne muchos niveles ya procesados en un único archivo binario que
+// el juego proyecta en memoria (mmap) y usa sin copiar: abrir el pack solo lee
+// el encabezado, y pasar a un nivel solo apunta el Mapa a sus secciones, así
+// que ni el arranque ni el cambio de nivel dependen de la cantidad de niveles.
+// Se arma con --compilar-pack a partir de mapas de texto.
+//
+//     EncabezadoPack
+//     NivelPack[cant_niveles]       índice de niveles
+//     secciones de cada nivel       celdas, paredes, puntos y vecinos, la tabla
+//                                   de saltos si se armó con --ia=tabla y los
+//                                   clusters de la jerarquía si se armó con --ia=hpa
+//
+// Las secciones empiezan en múltiplos de ALINEACION_PACK para que las
+// paredes (Uint64) y los puntos (int) se puedan leer directo de la proyección.
+// La tabla de saltos y los clusters también se usan directo de la proyección,
+// así que un nivel del pack no los vuelve a calcular al cargarse.
+// Los números se guardan con el orden de bytes de la máquina que armó el pack.
+
+#define MAGIA_PACK "PACPACK"
+#define VERSION_PACK 3
+#define ORDEN_BYTES_PACK 0x01020304u
+#define ALINEACION_PACK 8
+
+// Encabezado del pack
+typedef struct {
+    char magia[8];              // MAGIA_PACK terminado en '\0'
+    Uint32 version;             // VERSION_PACK
+    Uint32 orden_bytes;         // ORDEN_BYTES_PACK (detecta packs de máquinas con otro orden de bytes)
+    Uint32 cant_niveles;        // Entradas del índice
+    Uint32 tamano_nivel;        // sizeof(NivelPack) al armar el pack
+    Uint64 tamano_archivo;      // Tamaño total del pack en bytes
+} EncabezadoPack;
+
+// Entrada del índice: dimensiones, posiciones iniciales y dónde están las secciones del nivel
+typedef struct NivelPack {
+    char nombre[64];            // Nombre del mapa de texto de origen
+    Sint32 columnas, filas;     // Número de columnas y filas
+    Sint32 puntos_totales;      // Entradas de la sección de puntos
+    Sint32 paso;                // Celdas entre dos filas de las rejillas
+    Sint32 inicios[2 * (1 + CANT_FANTASMAS)]; // x, y de Pac-Man y de cada fantasma
+    Uint64 celdas;              // Desplazamiento de las celdas (filas * paso chars)
+    Uint64 paredes;             // Desplazamiento de la máscara de paredes (Uint64)
+    Uint64 puntos;              // Desplazamiento del índice de puntos (int)
+    Uint64 vecinos;             // Desplazamiento de la tabla de vecinos (Uint8)
+    Sint32 cantidad_saltos;     // Celdas libres de la tabla de saltos (0 si el pack no la tiene)
+    Sint32 tamano_cluster;      // sizeof(Cluster) al armar el pack (0 si no tiene la jerarquía)
+    Uint64 saltos_numero;       // Desplazamientos de los arreglos de la tabla de saltos (ver TablaSaltos)
+    Uint64 saltos_celda;
+    Uint64 saltos_direccion;
+    Uint64 clusters;            // Desplazamiento de los clusters de la jerarquía (ver Jerarquia)
+} NivelPack;
+
+// Pack abierto con --pack=archivo
+typedef struct {
+    const Uint8* datos;         // Inicio de la proyección del archivo
+    size_t tamano;              // Tamaño de la proyección
+    const NivelPack* niveles;   // Índice de niveles (dentro de la proyección)
+} PackNiveles;
+
+PackNiveles pack_niveles = {0};
+
+// Devuelve un puntero a la sección [desplazamiento, desplazamiento + tamano) del
+// pack, o NULL si se sale del archivo o no está alineada
+static const void* pack_seccion(Uint64 desplazamiento, Uint64 tamano) {
+    if (desplazamiento % ALINEACION_PACK != 0 || desplazamiento > pack_niveles.tamano ||
+        tamano > pack_niveles.tamano - desplazamiento) {
+        return NULL;
+    }
+    return pack_niveles.datos + desplazamiento;
+}
 
-    // Dibuja el estado actual del juego
-    dibujar_juego(mapa, &pacman, ghost, ghost2, ghost3);
+// ======================= Función pack_usar_nivel =======================
+// Apunta un Mapa a las secciones de su nivel en el pack, sin copiar ni leer
+// el laberinto. Solo se recorren los bordes de la tabla de vecinos y el índice
+// de puntos, para que un pack dañado no haga leer fuera del mapa.
+// Retorna: 0 si el nivel es válido o -1 en caso de error
+int pack_usar_nivel(Mapa* mapa) {
+    const NivelPack* nivel = mapa->nivel_pack;
+    Sint64 columnas = nivel->columnas, filas = nivel->filas, paso = nivel->paso;
+    Uint64 celdas = (Uint64)(paso * filas);
+    if (memchr(nivel->nombre, '\0', sizeof(nivel->nombre)) == NULL || columnas <= 0 || filas <= 0 ||
+        paso < columnas || paso * filas > SDL_MAX_SINT32 || nivel->puntos_totales < 0) {
+        printf("Error en el pack: el nivel %d tiene un encabezado inválido\n", (int)(nivel - pack_niveles.niveles) + 1);
+        return -1;
+    }
+    const char* celdas_pack = pack_seccion(nivel->celdas, celdas);
+    const Uint64* paredes = pack_seccion(nivel->paredes, (celdas + 63) / 64 * sizeof(Uint64));
+    const int* puntos = pack_seccion(nivel->puntos, (Uint64)nivel->puntos_totales * sizeof(int));
+    const Uint8* vecinos = pack_seccion(nivel->vecinos, celdas);
+    if (!celdas_pack || !paredes || !puntos || !vecinos) {
+        printf("Error en el pack: las secciones del nivel %s se salen del archivo\n", nivel->nombre);
+        return -1;
+    }
 
-    // Limpia la posición de Pac-Man
-    dibujar_rectangulo(pacman.x, pacman.y, 100, COLOR_FONDO);
+    // Las posiciones iniciales, los puntos y los vecinos de los bordes deben quedar dentro del mapa
+    bool valido = true;
+    for (int i = 0; i < 1 + CANT_FANTASMAS; i++) {
+        valido &= nivel->inicios[2 * i] >= 0 && nivel->inicios[2 * i] < columnas &&
+                  nivel->inicios[2 * i + 1] >= 0 && nivel->inicios[2 * i + 1] < filas;
+    }
+    for (int i = 0; i < nivel->puntos_totales; i++) {
+        valido &= puntos[i] >= 0 && (Uint64)puntos[i] < celdas;
+    }
+    for (int x = 0; x < columnas; x++) {
+        valido &= !(vecinos[x] & (1 << ARRIBA)) && !(vecinos[(filas - 1) * paso + x] & (1 << ABAJO));
+    }
+    for (int y = 0; y < filas; y++) {
+        valido &= !(vecinos[y * paso] & (1 << IZQUIERDA)) && !(vecinos[y * paso + columnas - 1] & (1 << DERECHA));
+    }
+    if (!valido) {
+        printf("Error en el pack: el nivel %s tiene datos fuera del mapa\n", nivel->nombre);
+        return -1;
+    }
 
-    // Reproduce el sonido de muerte de Pac-Man
-    reproducir_y_liberar_sonido(muerteSound, false, 0);
+    // El Mapa apunta a la proyección: las rejillas son de solo lectura y las simulaciones las comparten
+    mapa->celdas = (char*)celdas_pack;
+    mapa->paredes = (Uint64*)paredes;
+    mapa->puntos = (int*)puntos;
+    mapa->vecinos = (Uint8*)vecinos;
+    mapa->nombre = (char*)nivel->nombre;
+    mapa->columnas = (int)columnas;
+    mapa->filas = (int)filas;
+    mapa->paso = (int)paso;
+    mapa->puntos_totales = nivel->puntos_totales;
+    mapa->inicio_pacman = (Posicion){nivel->inicios[0], nivel->inicios[1]};
+    for (int i = 0; i < CANT_FANTASMAS; i++) {
+        mapa->inicio_fantasmas[i] = (Posicion){nivel->inicios[2 * (i + 1)], nivel->inicios[2 * (i + 1) + 1]};
+    }
+    return 0;
+}
 
-    // Animación de reducción del tamaño de Pac-Man
-    for (int i = 90; i > 5; i -= 5) {
-        // Establece el color de Pac-Man (amarillo)
-        SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+// ======================= Función pack_usar_saltos =======================
+// Apunta la tabla de saltos de un nivel del pack a su sección, sin copiarla
+// ni recalcularla. Como con el resto del nivel, solo se comprueba que las
+// secciones entren en el archivo: saltos_siguiente_paso descarta lo que no
+// corresponda al mapa.
+// Retorna: 0 si el mapa quedó con la tabla del pack o -1 si no la tiene
+int pack_usar_saltos(Mapa* mapa) {
+    const NivelPack* nivel = mapa->nivel_pack;
+    if (nivel == NULL || nivel->cantidad_saltos <= 0) {
+        return -1;
+    }
+    Uint64 celdas = (Uint64)mapa_celdas(mapa), cantidad = (Uint64)nivel->cantidad_saltos;
+    const int* numero = pack_seccion(nivel->saltos_numero, celdas * sizeof(int));
+    const int* celda = pack_seccion(nivel->saltos_celda, cantidad * sizeof(int));
+    const Uint8* direccion = cantidad <= celdas ? pack_seccion(nivel->saltos_direccion, cantidad * cantidad) : NULL;
+    if (!numero || !celda || !direccion) {
+        printf("Error en el pack: la tabla de saltos del nivel %s se sale del archivo\n", nivel->nombre);
+        return -1;
+    }
+    TablaSaltos* tabla = calloc(1, sizeof(TablaSaltos));
+    if (tabla == NULL) {
+        return -1;
+    }
+    tabla->cantidad = (int)cantidad;
+    tabla->numero = (int*)numero;
+    tabla->celda = (int*)celda;
+    tabla->direccion = (Uint8*)direccion;
+    tabla->memoria = sizeof(TablaSaltos); // El resto queda en la proyección
+    tabla->en_pack = true;
+    saltos_liberar(mapa->saltos);
+    mapa->saltos = tabla;
+    return 0;
+}
+
+// ===================== Función pack_usar_jerarquia =====================
+// Apunta la jerarquía de clusters de un nivel del pack a su sección, sin
+// recalcularla. Se recorren los nodos (pocos comparados con las celdas) para
+// que un pack dañado no haga salir a la búsqueda del mapa ni de sus clusters.
+// Retorna: 0 si el mapa quedó con la jerarquía del pack o -1 si no la tiene
+int pack_usar_jerarquia(Mapa* mapa) {
+    const NivelPack* nivel = mapa->nivel_pack;
+    if (nivel == NULL || nivel->tamano_cluster == 0) {
+        return -1;
+    }
+    Jerarquia* j = calloc(1, sizeof(Jerarquia));
+    if (j == NULL) {
+        return -1;
+    }
+    j->clusters_x = (mapa->columnas + TAMANO_CLUSTER - 1) / TAMANO_CLUSTER;
+    j->clusters_y = (mapa->filas + TAMANO_CLUSTER - 1) / TAMANO_CLUSTER;
+    j->columnas = mapa->columnas;
+    j->filas = mapa->filas;
+    j->paso = mapa->paso;
+    j->memoria = sizeof(Jerarquia); // Los clusters quedan en la proyección
+    j->en_pack = true;
+    int total = j->clusters_x * j->clusters_y;
+    j->clusters = (Cluster*)pack_seccion(nivel->clusters, (Uint64)total * sizeof(Cluster));
+    bool valido = j->clusters != NULL && nivel->tamano_cluster == (Sint32)sizeof(Cluster);
+    for (int c = 0; c < total && valido; c++) {
+        const Cluster* cluster = &j->clusters[c];
+        valido = cluster->cantidad >= 0 && cluster->cantidad <= MAX_NODOS_CLUSTER;
+        for (int i = 0; i < cluster->cantidad && valido; i++) {
+            // Cada nodo está en su cluster y sale de él hacia una celda libre
+            int celda = cluster->celdas[i];
+            valido = celda >= 0 && celda < mapa_celdas(mapa) && celda % mapa->paso < mapa->columnas &&
+                     jerarquia_cluster(j, celda) == c && cluster->lados[i] < 4 &&
+                     (mapa->vecinos[celda] & (1u << cluster->lados[i]));
+        }
+    }
+    if (!valido) {
+        printf("Error en el pack: la jerarquía del nivel %s no corresponde al mapa\n", nivel->nombre);
+        jerarquia_liberar(j);
+        return -1;
+    }
+    jerarquia_liberar(mapa->jerarquia);
+    mapa->jerarquia = j;
+    return 0;
+}
+
+// ======================= Función pack_cerrar =======================
+// Deshace la proyección del pack y vuelve a los niveles incluidos
+void pack_cerrar() {
+    if (pack_niveles.datos == NULL) {
+        return;
+    }
+    // Las tablas y las jerarquías de los niveles apuntan a la proyección: se sueltan antes
+    for (int i = 0; i < cant_niveles && mapas != mapas_incluidos; i++) {
+        mapa_liberar(&mapas[i]);
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(pack_niveles.datos);
+#else
+    munmap((void*)pack_niveles.datos, pack_niveles.tamano);
+#endif
+    if (mapas != mapas_incluidos) {
+        free(mapas);
+        mapas = mapas_incluidos;
+        cant_niveles = cant_tot_niv;
+    }
+    memset(&pack_niveles, 0, sizeof(pack_niveles));
+}
+
+// ======================= Función pack_abrir =======================
+// Proyecta el pack en memoria en modo solo lectura y reemplaza los niveles
+// del juego por los del pack. Solo se valida el encabezado: cada nivel se
+// comprueba recién cuando se lo carga.
+// Retorna: 0 si se abrió correctamente o -1 en caso de error
+int pack_abrir(const char* ruta) {
+    pack_cerrar();
+
+    // Proyección del archivo completo
+    const Uint8* datos = NULL;
+    size_t tamano = 0;
+#ifdef _WIN32
+    HANDLE archivo = CreateFileA(ruta, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (archivo != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER tamano_archivo;
+        if (GetFileSizeEx(archivo, &tamano_archivo) && tamano_archivo.QuadPart >= (LONGLONG)sizeof(EncabezadoPack)) {
+            tamano = (size_t)tamano_archivo.QuadPart;
+            HANDLE proyeccion = CreateFileMappingA(archivo, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (proyeccion != NULL) {
+                datos = MapViewOfFile(proyeccion, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(proyeccion); // La vista mantiene viva la proyección
+            }
+        }
+        CloseHandle(archivo);
+    }
+#else
+    int archivo = open(ruta, O_RDONLY);
+    if (archivo != -1) {
+        struct stat info;
+        if (fstat(archivo, &info) == 0 && info.st_size >= (off_t)sizeof(EncabezadoPack)) {
+            tamano = (size_t)info.st_size;
+            void* proyeccion = mmap(NULL, tamano, PROT_READ, MAP_PRIVATE, archivo, 0);
+            datos = proyeccion != MAP_FAILED ? proyeccion : NULL;
+        }
+        close(archivo); // La proyección sigue siendo válida sin el descriptor
+    }
+#endif
+    if (datos == NULL) {
+        printf("No se pudo abrir el pack de niveles %s\n", ruta);
+        return -1;
+    }
+    pack_niveles.datos = datos;
+    pack_niveles.tamano = tamano;
+
+    // Valida el encabezado y que el índice entre en el archivo
+    const EncabezadoPack* encabezado = (const EncabezadoPack*)datos;
+    const char* error = NULL;
+    if (memcmp(encabezado->magia, MAGIA_PACK, sizeof(MAGIA_PACK)) != 0) {
+        error = "no es un pack de niveles";
+    } else if (encabezado->orden_bytes != ORDEN_BYTES_PACK) {
+        error = "se armó en una máquina con otro orden de bytes";
+    } else if (encabezado->version != VERSION_PACK || encabezado->tamano_nivel != sizeof(NivelPack)) {
+        error = "es de otra versión";
+    } else if (encabezado->tamano_archivo != tamano) {
+        error = "está incompleto";
+    } else if (encabezado->cant_niveles == 0 || encabezado->cant_niveles > SDL_MAX_SINT32 / sizeof(NivelPack)) {
+        error = "no tiene niveles";
+    } else if ((pack_niveles.niveles = pack_seccion(sizeof(EncabezadoPack), (Uint64)encabezado->cant_niveles * sizeof(NivelPack))) == NULL) {
+        error = "el índice se sale del archivo";
+    }
+    Mapa* niveles = error == NULL ? calloc(encabezado->cant_niveles, sizeof(Mapa)) : NULL;
+    if (error == NULL && niveles == NULL) {
+        error = "no hay memoria para el índice";
+    }
+    if (error != NULL) {
+        printf("Error en el pack %s: %s\n", ruta, error);
+        pack_cerrar();
+        return -1;
+    }
+
+    // Cada nivel queda apuntando a su entrada del índice; se carga al jugarlo
+    for (Uint32 i = 0; i < encabezado->cant_niveles; i++) {
+        niveles[i].nombre = (char*)ruta;
+        niveles[i].nivel_pack = &pack_niveles.niveles[i];
+    }
+    mapas = niveles;
+    cant_niveles = (int)encabezado->cant_niveles;
+    return 0;
+}
+
+
+// ============================ Función leer_mapa ============================
+// Función para leer el mapa desde un archivo en una sola pasada: guarda el
+// laberinto y arma a la vez la máscara de paredes, el índice de puntos y las
+// posiciones iniciales, validando el contenido; al final calcula la tabla de vecinos
+// Recibe un puntero a Mapa con el nombre del archivo; si ya estaba cargado, lo reemplaza
+// Los niveles de un pack no se leen: el Mapa pasa a apuntar a sus datos ya procesados
+// Retorna: 0 si se leyó correctamente o -1 en caso de error
+int leer_mapa(Mapa* mapa) {
+    if (mapa->nivel_pack != NULL) {
+        mapa_liberar(mapa); // Solo suelta la tabla y la jerarquía: las rejillas son del pack
+        return pack_usar_nivel(mapa);
+    }
+
+    // Abre el archivo de texto que contiene el diseño del mapa
+    FILE* file = fopen(mapa->nombre, "r");
+    if (!file) {
+        // Si no se pudo abrir el archivo, muestra un error y retorna -1
+        perror("No se pudo abrir el archivo de mapa");
+        return -1;
+    }
+    mapa_liberar(mapa);
+
+    // Encabezado (opcional): ningún carácter válido del laberinto empieza con 'M'
+    int columnas = 0, filas = 0, paso = 0, puntos_declarados = -1;
+    bool con_encabezado = false;
+    int c = getc(file);
+    if (c == ENCABEZADO_MAPA[0]) {
+        con_encabezado = true;
+        if (fscanf(file, "APA %d %d %d", &columnas, &filas, &puntos_declarados) != 3 ||
+            columnas <= 0 || filas <= 0 || puntos_declarados < 0 ||
+            ((Sint64)columnas + ALINEACION_FILAS) * filas > SDL_MAX_SINT32 ||
+            puntos_declarados > (Sint64)columnas * filas) {
+            printf("Error en el mapa %s: encabezado inválido (se esperaba \"%s columnas filas puntos\")\n",
+                   mapa->nombre, ENCABEZADO_MAPA);
+            fclose(file);
+            return -1;
+        }
+        while ((c = getc(file)) != '\n' && c != EOF) {
+            // Descarta el resto de la línea del encabezado
+        }
+        paso = paso_filas(columnas);
+    } else if (c != EOF) {
+        ungetc(c, file);
+    }
+
+    // Arreglos del mapa; con encabezado se reservan de una vez, sin él crecen a medida que se lee
+    char* celdas = NULL;
+    Uint64* paredes = NULL;
+    int* puntos = NULL;
+    int capacidad_celdas = 0, capacidad_paredes = 0, capacidad_puntos = 0;
+    bool memoria = true;
+    if (con_encabezado) {
+        memoria = asegurar_capacidad((void**)&celdas, &capacidad_celdas, paso * filas, sizeof(char)) &&
+                  asegurar_capacidad((void**)&paredes, &capacidad_paredes, (paso * filas - 1) / 64 + 1, sizeof(Uint64)) &&
+                  asegurar_capacidad((void**)&puntos, &capacidad_puntos, puntos_declarados > 0 ? puntos_declarados : 1, sizeof(int));
+    }
+
+    // Personajes cuya posición inicial apareció en el mapa (bit 0: Pac-Man, bits 1 a 3: fantasmas)
+    const char marcadores[1 + CANT_FANTASMAS] = {PACMAN, GHOST, GHOST2, GHOST3};
+    Posicion inicios[1 + CANT_FANTASMAS];
+    int encontrados = 0;
+
+    // Lee el laberinto carácter por carácter; "cantidad" cuenta las celdas escritas
+    // con el relleno, así que siempre vale y * paso + x
+    char error[160] = "";
+    int cantidad = 0, cant_puntos = 0, x = 0, y = 0;
+    while (memoria && error[0] == '\0') {
+        c = getc(file);
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n' || c == EOF) {
+            // Fin de una fila: todas deben tener el mismo ancho (las líneas vacías se ignoran)
+            if (x > 0) {
+                if (columnas == 0) {
+                    columnas = x;
+                    paso = paso_filas(columnas); // Sin encabezado, el ancho se conoce al terminar la primera fila
+                } else if (x != columnas) {
+                    snprintf(error, sizeof(error), "la fila %d tiene %d columnas y se esperaban %d", y + 1, x, columnas);
+                    break;
+                }
+
+                // Relleno hasta el paso: paredes que no se dibujan ni se recorren
+                for (; x < paso && memoria; x++) {
+                    memoria = asegurar_capacidad((void**)&celdas, &capacidad_celdas, cantidad + 1, sizeof(char)) &&
+                              asegurar_capacidad((void**)&paredes, &capacidad_paredes, cantidad / 64 + 1, sizeof(Uint64));
+                    if (memoria) {
+                        if (cantidad % 64 == 0) {
+                            paredes[cantidad / 64] = 0;
+                        }
+                        paredes[cantidad / 64] |= (Uint64)1 << (cantidad % 64);
+                        celdas[cantidad++] = OBSTACLE;
+                    }
+                }
+                y++;
+                x = 0;
+            }
+            if (c == EOF) {
+                break;
+            }
+            continue;
+        }
+        if ((con_encabezado && y >= filas) || (columnas > 0 && x >= columnas)) {
+            snprintf(error, sizeof(error), "la fila %d es más larga o sobran filas (tamaño declarado %dx%d)", y + 1, columnas, filas);
+            break;
+        }
+
+        // Clasifica la celda y arma la máscara de paredes y el índice de puntos en la misma pasada
+        memoria = asegurar_capacidad((void**)&celdas, &capacidad_celdas, cantidad + 1, sizeof(char)) &&
+                  asegurar_capacidad((void**)&paredes, &capacidad_paredes, cantidad / 64 + 1, sizeof(Uint64));
+        if (!memoria) {
+            break;
+        }
+        if (cantidad % 64 == 0) {
+            paredes[cantidad / 64] = 0;
+        }
+        switch (c) {
+            case OBSTACLE:
+                paredes[cantidad / 64] |= (Uint64)1 << (cantidad % 64);
+                break;
+            case POINT:
+                memoria = asegurar_capacidad((void**)&puntos, &capacidad_puntos, cant_puntos + 1, sizeof(int));
+                if (memoria) {
+                    puntos[cant_puntos++] = cantidad;
+                }
+                break;
+            case PATH:
+                break;
+            default: {
+                const char* marcador = memchr(marcadores, c, sizeof(marcadores));
+                if (marcador == NULL) {
+                    snprintf(error, sizeof(error), "carácter inválido '%c' en la fila %d, columna %d", c, y + 1, x + 1);
+                } else if (encontrados & (1 << (marcador - marcadores))) {
+                    snprintf(error, sizeof(error), "la posición inicial '%c' aparece más de una vez", c);
+                } else {
+                    encontrados |= 1 << (marcador - marcadores);
+                    inicios[marcador - marcadores] = (Posicion){x, y};
+                    c = PATH; // Debajo de cada personaje hay camino libre
+                }
+                break;
+            }
+        }
+        celdas[cantidad++] = (char)c;
+        x++;
+    }
+    fclose(file);
+
+    // Validaciones del mapa completo
+    if (!memoria) {
+        snprintf(error, sizeof(error), "no hay memoria suficiente");
+    } else if (error[0] == '\0') {
+        if (con_encabezado && y != filas) {
+            snprintf(error, sizeof(error), "tiene %d filas y el encabezado declara %d", y, filas);
+        } else if (y == 0) {
+            snprintf(error, sizeof(error), "está vacío");
+        } else if (con_encabezado && cant_puntos != puntos_declarados) {
+            snprintf(error, sizeof(error), "tiene %d puntos y el encabezado declara %d", cant_puntos, puntos_declarados);
+        } else if (con_encabezado && encontrados != (1 << (1 + CANT_FANTASMAS)) - 1) {
+            snprintf(error, sizeof(error), "faltan posiciones iniciales (se necesitan 'C', 'G', 'H' e 'I')");
+        }
+    }
+    filas = y;
+
+    // Sin encabezado, los personajes que no aparecen en el mapa arrancan en las posiciones de siempre
+    const Posicion por_defecto[1 + CANT_FANTASMAS] = {{1, 6}, {9, 5}, {8, 5}, {12, 5}};
+    for (int i = 0; i < 1 + CANT_FANTASMAS && error[0] == '\0'; i++) {
+        if (!(encontrados & (1 << i))) {
+            inicios[i] = por_defecto[i];
+            if (inicios[i].x >= columnas || inicios[i].y >= filas ||
+                celdas[inicios[i].y * paso + inicios[i].x] == OBSTACLE) {
+                snprintf(error, sizeof(error), "no indica la posición inicial '%c' y la de siempre no es válida", marcadores[i]);
+            }
+        }
+    }
+
+    // Tabla de vecinos para la búsqueda de caminos
+    Uint8* vecinos = NULL;
+    if (error[0] == '\0' && (vecinos = calcular_vecinos(paredes, columnas, filas, paso)) == NULL) {
+        snprintf(error, sizeof(error), "no hay memoria suficiente");
+    }
+
+    if (error[0] != '\0') {
+        printf("Error en el mapa %s: %s\n", mapa->nombre, error);
+        free(celdas);
+        free(paredes);
+        free(puntos);
+        return -1;
+    }
+
+    mapa->celdas = celdas;
+    mapa->vecinos = vecinos;
+    mapa->paredes = paredes;
+    mapa->puntos = puntos;
+    mapa->columnas = columnas;
+    mapa->filas = filas;
+    mapa->paso = paso;
+    mapa->puntos_totales = cant_puntos;
+    mapa->inicio_pacman = inicios[0];
+    for (int i = 0; i < CANT_FANTASMAS; i++) {
+        mapa->inicio_fantasmas[i] = inicios[1 + i];
+    }
+    return 0; // Retorna 0 si se cargó correctamente
+}
+
+// =========================== Función cargar_mapa ===========================
+// Lee el mapa (ver leer_mapa) y, con --ia=tabla, arma una sola vez su tabla de
+// saltos, o con --ia=hpa su jerarquía de clusters (o usa las del pack); si no
+// entran en memoria el nivel se juega igual, con A*. Un mapa ya cargado que no
+// cambió desde entonces se conserva con su tabla y su jerarquía, así que
+// volver a empezar o repetir un nivel no los recalcula.
+// Retorna: 0 si se cargó correctamente o -1 en caso de error
+int cargar_mapa(Mapa* mapa) {
+    if ((mapa->celdas == NULL || mapa->cambios != 0) && leer_mapa(mapa) == -1) {
+        return -1;
+    }
+    if (precalcular_saltos && mapa->saltos == NULL && pack_usar_saltos(mapa) == -1) {
+        saltos_construir(mapa);
+    }
+    if (precalcular_jerarquia && mapa->jerarquia == NULL && pack_usar_jerarquia(mapa) == -1) {
+        jerarquia_construir(mapa);
+    }
+    return 0;
+}
+
+
+
+// ======================= Función escribir_seccion =======================
+// Escribe una sección del pack a partir de la posición alineada siguiente
+// Retorna: el desplazamiento donde quedó la sección
+static Uint64 escribir_seccion(FILE* archivo, Uint64* posicion, const void* datos, size_t tamano) {
+    static const Uint8 relleno[ALINEACION_PACK] = {0};
+    size_t sobra = (size_t)(*posicion % ALINEACION_PACK);
+    if (sobra != 0) {
+        fwrite(relleno, 1, ALINEACION_PACK - sobra, archivo);
+        *posicion += ALINEACION_PACK - sobra;
+    }
+    Uint64 inicio = *posicion;
+    fwrite(datos, 1, tamano, archivo);
+    *posicion += tamano;
+    return inicio;
+}
+
+// ======================= Función compilar_pack =======================
+// Arma un pack de niveles con los mapas de texto indicados, en ese orden.
+// Los mapas se cargan de a uno: cada nivel se escribe apenas se lee y el
+// índice se completa al final. Con --ia=tabla guarda también la tabla de
+// saltos, y con --ia=hpa la jerarquía de clusters.
+// Parámetros:
+//   salida: Archivo del pack a crear
+//   archivos: Mapas de texto que forman los niveles
+//   cantidad: Cantidad de mapas
+// Retorna: 0 si el pack se armó correctamente o -1 en caso de error
+int compilar_pack(const char* salida, char* archivos[], int cantidad) {
+    NivelPack* indice = calloc(cantidad > 0 ? cantidad : 1, sizeof(NivelPack));
+    FILE* archivo = fopen(salida, "wb");
+    if (indice == NULL || archivo == NULL) {
+        printf("No se pudo crear el pack de niveles %s\n", salida);
+        free(indice);
+        if (archivo != NULL) {
+            fclose(archivo);
+        }
+        return -1;
+    }
+
+    // El encabezado y el índice se reservan al principio y se escriben al final
+    EncabezadoPack encabezado = {MAGIA_PACK, VERSION_PACK, ORDEN_BYTES_PACK, (Uint32)cantidad, sizeof(NivelPack), 0};
+    fwrite(&encabezado, sizeof(encabezado), 1, archivo);
+    fwrite(indice, sizeof(NivelPack), cantidad, archivo);
+    Uint64 posicion = sizeof(encabezado) + (Uint64)cantidad * sizeof(NivelPack);
+
+    int resultado = 0;
+    for (int i = 0; i < cantidad && resultado == 0; i++) {
+        Mapa mapa = {.nombre = archivos[i]};
+        if (leer_mapa(&mapa) == -1) {
+            resultado = -1;
+            break;
+        }
+
+        // Nombre sin la carpeta, para que el pack no dependa de dónde se armó
+        NivelPack* nivel = &indice[i];
+        const char* nombre = archivos[i];
+        for (const char* c = archivos[i]; *c != '\0'; c++) {
+            if (*c == '/' || *c == '\\') {
+                nombre = c + 1;
+            }
+        }
+        snprintf(nivel->nombre, sizeof(nivel->nombre), "%s", nombre);
+        nivel->columnas = mapa.columnas;
+        nivel->paso = mapa.paso;
+        nivel->filas = mapa.filas;
+        nivel->puntos_totales = mapa.puntos_totales;
+        nivel->inicios[0] = mapa.inicio_pacman.x;
+        nivel->inicios[1] = mapa.inicio_pacman.y;
+        for (int f = 0; f < CANT_FANTASMAS; f++) {
+            nivel->inicios[2 * (f + 1)] = mapa.inicio_fantasmas[f].x;
+            nivel->inicios[2 * (f + 1) + 1] = mapa.inicio_fantasmas[f].y;
+        }
+
+        // Secciones del nivel, cada una alineada
+        size_t celdas = (size_t)mapa_celdas(&mapa);
+        nivel->celdas = escribir_seccion(archivo, &posicion, mapa.celdas, celdas);
+        nivel->paredes = escribir_seccion(archivo, &posicion, mapa.paredes, (celdas + 63) / 64 * sizeof(Uint64));
+        nivel->puntos = escribir_seccion(archivo, &posicion, mapa.puntos, (size_t)mapa.puntos_totales * sizeof(int));
+        nivel->vecinos = escribir_seccion(archivo, &posicion, mapa.vecinos, celdas);
+
+        // Con --ia=tabla, la tabla de saltos (si entra en el límite de memoria) para no armarla al jugar
+        if (precalcular_saltos && saltos_construir(&mapa) == 0) {
+            const TablaSaltos* tabla = mapa.saltos;
+            nivel->cantidad_saltos = tabla->cantidad;
+            nivel->saltos_numero = escribir_seccion(archivo, &posicion, tabla->numero, celdas * sizeof(int));
+            nivel->saltos_celda = escribir_seccion(archivo, &posicion, tabla->celda, (size_t)tabla->cantidad * sizeof(int));
+            nivel->saltos_direccion = escribir_seccion(archivo, &posicion, tabla->direccion, (size_t)tabla->cantidad * tabla->cantidad);
+        }
+
+        // Con --ia=hpa, los clusters de la jerarquía
+        if (precalcular_jerarquia && jerarquia_construir(&mapa) == 0) {
+            const Jerarquia* j = mapa.jerarquia;
+            nivel->tamano_cluster = (Sint32)sizeof(Cluster);
+            nivel->clusters = escribir_seccion(archivo, &posicion, j->clusters, (size_t)j->clusters_x * j->clusters_y * sizeof(Cluster));
+        }
+        mapa_liberar(&mapa);
+    }
+
+    // Completa el encabezado y el índice
+    if (resultado == 0) {
+        encabezado.tamano_archivo = posicion;
+        if (fseek(archivo, 0, SEEK_SET) != 0 ||
+            fwrite(&encabezado, sizeof(encabezado), 1, archivo) != 1 ||
+            fwrite(indice, sizeof(NivelPack), cantidad, archivo) != (size_t)cantidad) {
+            resultado = -1;
+        }
+    }
+    if (ferror(archivo)) {
+        resultado = -1;
+    }
+    if (fclose(archivo) != 0) {
+        resultado = -1;
+    }
+    free(indice);
+
+    if (resultado == 0) {
+        printf("Pack %s: %d niveles, %llu bytes\n", salida, cantidad, (unsigned long long)posicion);
+    } else {
+        printf("No se pudo armar el pack de niveles %s\n", salida);
+        remove(salida);
+    }
+    return resultado;
+}
+
+
+// ============================ Banco de Sonidos ============================
+// Los efectos se cargan una sola vez al empezar y quedan en memoria hasta que
+// termina el programa. Cada grupo tiene canales reservados: un sonido se
+// reproduce en un canal libre de su grupo o, si están todos ocupados, reemplaza
+// al más antiguo del grupo. Así ningún sonido espera ni se pierde por otro
+// que esté sonando. El backend nulo no abre el dispositivo de audio y solo
+// cuenta las reproducciones, para el modo sin ventana y para las pruebas.
+
+// Archivo y grupo de canales de cada sonido
+static const struct {
+    const char* archivo;
+    enum GrupoAudio grupo;
+} sonidos_banco[CANT_SONIDOS] = {
+    {"pacman_chomp.wav", GRUPO_EFECTOS},
+    {"Inicio.wav", GRUPO_MUSICA},
+    {"Muerte.wav", GRUPO_MUSICA},
+};
+
+// Canales reservados para cada grupo (los de efectos permiten superponer bocados seguidos)
+static const int canales_grupo[CANT_GRUPOS] = {4, 1};
+
+typedef struct {
+    enum BackendAudio backend;          // Backend en uso
+    bool abierto;                       // true si se abrió el dispositivo de audio
+    Mix_Chunk* sonidos[CANT_SONIDOS];   // Sonidos cargados (NULL si no se pudo cargar o con el backend nulo)
+    Uint64 reproducidos[CANT_SONIDOS];  // Veces que se pidió cada sonido
+    Uint64 reemplazados;                // Sonidos que cortaron al más antiguo de su grupo
+    int muestras;                       // Muestras del búfer del mezclador
+} BancoSonidos;
+
+BancoSonidos banco_sonidos = {.backend = AUDIO_NULO};
+
+// ========================= Función audio_iniciar =========================
+// Abre el audio con el backend y el tamaño de búfer indicados, reserva los
+// canales de cada grupo y carga todos los sonidos. Si SDL_mixer no puede
+// abrir el dispositivo, el juego sigue con el backend nulo
+void audio_iniciar(enum BackendAudio backend, int muestras) {
+    memset(&banco_sonidos, 0, sizeof(banco_sonidos));
+    banco_sonidos.backend = AUDIO_NULO;
+    banco_sonidos.muestras = muestras;
+    if (backend == AUDIO_NULO) {
+        return;
+    }
+
+    // Inicializa SDL_mixer con frecuencia de audio de 44100 Hz, formato de audio predeterminado
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, muestras) < 0) {
+        printf("Error al inicializar SDL_mixer: %s (se sigue sin sonido)\n", Mix_GetError());
+        return;
+    }
+    banco_sonidos.abierto = true;
+    banco_sonidos.backend = AUDIO_SDL;
+
+    // Canales de cada grupo, reservados para que Mix_PlayChannel(-1, ...) no los tome
+    int total = 0;
+    for (int g = 0; g < CANT_GRUPOS; g++) {
+        total += canales_grupo[g];
+    }
+    Mix_AllocateChannels(total);
+    Mix_ReserveChannels(total);
+    for (int g = 0, primero = 0; g < CANT_GRUPOS; primero += canales_grupo[g], g++) {
+        Mix_GroupChannels(primero, primero + canales_grupo[g] - 1, g);
+    }
+
+    for (int i = 0; i < CANT_SONIDOS; i++) {
+        banco_sonidos.sonidos[i] = Mix_LoadWAV(sonidos_banco[i].archivo);
+        if (banco_sonidos.sonidos[i] == NULL) {
+            printf("Error al cargar el sonido %s: %s\n", sonidos_banco[i].archivo, Mix_GetError());
+        }
+    }
+}
+
+// ======================= Función audio_reproducir =======================
+// Reproduce un sonido en un canal de su grupo sin esperar: usa un canal
+// libre o corta el sonido más antiguo del grupo
+void audio_reproducir(enum Sonido sonido) {
+    if (sonido == SONIDO_NINGUNO) {
+        return;
+    }
+    banco_sonidos.reproducidos[sonido]++;
+    if (banco_sonidos.backend == AUDIO_NULO || banco_sonidos.sonidos[sonido] == NULL) {
+        return;
+    }
+    int grupo = sonidos_banco[sonido].grupo;
+    int canal = Mix_GroupAvailable(grupo);
+    if (canal == -1) {
+        canal = Mix_GroupOldest(grupo);
+        banco_sonidos.reemplazados++;
+    }
+    Mix_PlayChannel(canal, banco_sonidos.sonidos[sonido], 0);
+}
+
+// Imprime cuántas veces se reprodujo cada sonido y con qué búfer (con --estadisticas)
+void audio_imprimir_estadisticas(void) {
+    printf("Audio (%s, búfer de %d muestras, %.1f ms): comer %llu, inicio %llu, muerte %llu, reemplazados %llu\n",
+           banco_sonidos.backend == AUDIO_SDL ? "SDL_mixer" : "nulo", banco_sonidos.muestras,
+           banco_sonidos.muestras * 1000.0 / 44100.0,
+           (unsigned long long)banco_sonidos.reproducidos[SONIDO_COMER],
+           (unsigned long long)banco_sonidos.reproducidos[SONIDO_INICIO],
+           (unsigned long long)banco_sonidos.reproducidos[SONIDO_MUERTE],
+           (unsigned long long)banco_sonidos.reemplazados);
+}
+
+// ========================== Función audio_cerrar ==========================
+// Libera los sonidos cargados y cierra el audio al terminar el juego
+void audio_cerrar(void) {
+    for (int i = 0; i < CANT_SONIDOS; i++) {
+        if (banco_sonidos.sonidos[i] != NULL) {
+            Mix_FreeChunk(banco_sonidos.sonidos[i]);
+            banco_sonidos.sonidos[i] = NULL;
+        }
+    }
+    if (banco_sonidos.abierto) {
+        Mix_CloseAudio();
+        banco_sonidos.abierto = false;
+    }
+}
+
+
+
+// ============================ Texto en Pantalla ============================
+// La fuente se abre una sola vez y cada carácter imprimible se dibuja en un
+// atlas: una única textura con todos los glifos, en blanco. Los textos se
+// arman con rectángulos del atlas (coloreados por vértice) y se envían con
+// una sola llamada a SDL_RenderGeometry, sin reservar memoria por llamada.
+// Así el marcador (puntaje y FPS) se puede dibujar en cada cuadro.
+
+#define ARCHIVO_FUENTE "Letras.ttf"
+#define TAMANO_FUENTE 64            // Tamaño de la fuente en el atlas (el de los mensajes)
+#define PRIMER_GLIFO 32             // Espacio
+#define ULTIMO_GLIFO 126            // '~'
+#define ANCHO_ATLAS 1024            // Ancho máximo de la superficie del atlas
+#define MAX_CARACTERES_TEXTO 64     // Máximo de caracteres por texto dibujado
+
+typedef struct {
+    TTF_Font* fuente;                                       // Fuente abierta durante todo el juego
+    SDL_Surface* superficie;                                // Atlas en memoria (para recrear la textura)
+    SDL_Texture* textura;                                   // Atlas en el renderizador actual
+    SDL_Rect glifos[ULTIMO_GLIFO - PRIMER_GLIFO + 1];       // Rectángulo de cada glifo en el atlas
+    int alto;                                               // Alto de una línea de texto
+    bool iniciado;                                          // true si ya se intentó crear el atlas
+} AtlasTexto;
+
+AtlasTexto atlas_texto = {0};
+
+// Crea el atlas de glifos (una sola vez)
+// Retorna: true si el atlas está disponible
+bool texto_iniciar(void) {
+    if (atlas_texto.iniciado) {
+        return atlas_texto.superficie != NULL;
+    }
+    atlas_texto.iniciado = true;
+
+    // Inicializa SDL_ttf y carga la fuente, verificando errores
+    if (TTF_Init() == -1) {
+        printf("Error al inicializar SDL_ttf: %s\n", TTF_GetError());
+        return false;
+    }
+    atlas_texto.fuente = TTF_OpenFont(ARCHIVO_FUENTE, TAMANO_FUENTE);
+    if (!atlas_texto.fuente) {
+        printf("Error al cargar la fuente: %s\n", TTF_GetError());
+        TTF_Quit();
+        return false;
+    }
+    atlas_texto.alto = TTF_FontHeight(atlas_texto.fuente);
+
+    // Dibuja cada glifo por separado, en blanco para poder colorearlo al usarlo
+    SDL_Color blanco = {255, 255, 255, 255};
+    SDL_Surface* superficies[ULTIMO_GLIFO - PRIMER_GLIFO + 1];
+    int x = 0, y = 0;
+    for (int c = PRIMER_GLIFO; c <= ULTIMO_GLIFO; c++) {
+        char caracter[2] = {(char)c, '\0'};
+        int i = c - PRIMER_GLIFO;
+        int ancho = 0;
+        TTF_SizeText(atlas_texto.fuente, caracter, &ancho, NULL);
+        superficies[i] = TTF_RenderText_Blended(atlas_texto.fuente, caracter, blanco);
+        if (superficies[i] != NULL) {
+            ancho = superficies[i]->w;
+        }
+
+        // Ubica el glifo en la fila actual del atlas o en una nueva
+        if (x + ancho > ANCHO_ATLAS) {
+            x = 0;
+            y += atlas_texto.alto + 1;
+        }
+        atlas_texto.glifos[i] = (SDL_Rect){x, y, ancho, atlas_texto.alto};
+        x += ancho + 1; // Un píxel de separación para que el filtrado no mezcle glifos vecinos
+    }
+
+    // Copia los glifos al atlas, conservando su transparencia
+    atlas_texto.superficie = SDL_CreateRGBSurfaceWithFormat(0, ANCHO_ATLAS, y + atlas_texto.alto, 32, SDL_PIXELFORMAT_RGBA32);
+    for (int i = 0; i <= ULTIMO_GLIFO - PRIMER_GLIFO; i++) {
+        if (superficies[i] != NULL) {
+            if (atlas_texto.superficie != NULL) {
+                SDL_Rect destino = atlas_texto.glifos[i];
+                SDL_SetSurfaceBlendMode(superficies[i], SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(superficies[i], NULL, atlas_texto.superficie, &destino);
+            }
+            SDL_FreeSurface(superficies[i]);
+        }
+    }
+    if (atlas_texto.superficie == NULL) {
+        printf("Error al crear el atlas de texto: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+// Libera la textura del atlas (antes de destruir el renderizador o si se perdió su contenido)
+void texto_liberar_textura(void) {
+    if (atlas_texto.textura != NULL) {
+        SDL_DestroyTexture(atlas_texto.textura);
+        atlas_texto.textura = NULL;
+    }
+}
+
+// Libera el atlas y cierra la fuente al terminar el juego
+void texto_cerrar(void) {
+    texto_liberar_textura();
+    if (atlas_texto.superficie != NULL) {
+        SDL_FreeSurface(atlas_texto.superficie);
+    }
+    if (atlas_texto.fuente != NULL) {
+        TTF_CloseFont(atlas_texto.fuente);
+        TTF_Quit();
+    }
+    memset(&atlas_texto, 0, sizeof(atlas_texto));
+}
+
+// Mide el ancho en píxeles de un texto dibujado al porcentaje "escala" del tamaño de la fuente
+int texto_ancho(const char* texto, int escala) {
+    int ancho = 0;
+    for (int n = 0; texto[n] != '\0' && n < MAX_CARACTERES_TEXTO; n++) {
+        unsigned char c = (unsigned char)texto[n];
+        if (c >= PRIMER_GLIFO && c <= ULTIMO_GLIFO) {
+            ancho += atlas_texto.glifos[c - PRIMER_GLIFO].w;
+        }
+    }
+    return ancho * escala / 100;
+}
+
+// ========================= Función dibujar_texto =========================
+// Dibuja un texto con su esquina superior izquierda en (x, y)
+// Parámetros:
+//   texto: Texto a dibujar (los caracteres fuera del atlas se omiten)
+//   escala: Tamaño como porcentaje del tamaño de la fuente (100 = TAMANO_FUENTE)
+//   color: Color del texto
+void dibujar_texto(const char* texto, int x, int y, int escala, SDL_Color color) {
+    if (!texto_iniciar()) {
+        return;
+    }
+
+    // La textura se crea en el renderizador actual la primera vez que se usa
+    if (atlas_texto.textura == NULL) {
+        atlas_texto.textura = SDL_CreateTextureFromSurface(renderer, atlas_texto.superficie);
+        if (atlas_texto.textura == NULL) {
+            return;
+        }
+        SDL_SetTextureBlendMode(atlas_texto.textura, SDL_BLENDMODE_BLEND);
+    }
+
+    // Dos triángulos por carácter, en arreglos reutilizados entre llamadas
+    static SDL_Vertex vertices[4 * MAX_CARACTERES_TEXTO];
+    static int indices[6 * MAX_CARACTERES_TEXTO];
+    float ancho_atlas = (float)atlas_texto.superficie->w;
+    float alto_atlas = (float)atlas_texto.superficie->h;
+    float alto = (float)(atlas_texto.alto * escala) / 100.0f;
+    float cursor = (float)x;
+    int cantidad = 0;
+
+    for (int n = 0; texto[n] != '\0' && n < MAX_CARACTERES_TEXTO; n++) {
+        unsigned char c = (unsigned char)texto[n];
+        if (c < PRIMER_GLIFO || c > ULTIMO_GLIFO) {
+            continue;
+        }
+        SDL_Rect glifo = atlas_texto.glifos[c - PRIMER_GLIFO];
+        float ancho = (float)(glifo.w * escala) / 100.0f;
+        float u0 = glifo.x / ancho_atlas, u1 = (glifo.x + glifo.w) / ancho_atlas;
+        float v0 = glifo.y / alto_atlas, v1 = (glifo.y + glifo.h) / alto_atlas;
+
+        SDL_Vertex* v = &vertices[4 * cantidad];
+        v[0] = (SDL_Vertex){{cursor, (float)y}, color, {u0, v0}};
+        v[1] = (SDL_Vertex){{cursor + ancho, (float)y}, color, {u1, v0}};
+        v[2] = (SDL_Vertex){{cursor + ancho, (float)y + alto}, color, {u1, v1}};
+        v[3] = (SDL_Vertex){{cursor, (float)y + alto}, color, {u0, v1}};
+
+        int* indice = &indices[6 * cantidad];
+        int base = 4 * cantidad;
+        indice[0] = base; indice[1] = base + 1; indice[2] = base + 2;
+        indice[3] = base; indice[4] = base + 2; indice[5] = base + 3;
+
+        cursor += ancho;
+        cantidad++;
+    }
+
+    if (cantidad > 0) {
+        SDL_RenderGeometry(renderer, atlas_texto.textura, vertices, 4 * cantidad, indices, 6 * cantidad);
+    }
+}
+
+
+// Marcador que se dibuja sobre el juego en cada cuadro (--marcador)
+bool mostrar_marcador = false;
+char texto_marcador[MAX_CARACTERES_TEXTO] = "";
+
+#ifdef TRAZAS
+// Mediciones del último cuadro, debajo del marcador (--traza-overlay, ver Trazas por Cuadro)
+bool mostrar_traza = false;
+char texto_traza[MAX_CARACTERES_TEXTO] = "";
+#endif
+
+// Dibuja el marcador en la esquina superior izquierda, sobre la fila superior del mapa
+// Retorna: Cantidad de llamadas de dibujo realizadas
+int dibujar_marcador(void) {
+    int llamadas = 0;
+    if (mostrar_marcador && texto_marcador[0] != '\0') {
+        dibujar_texto(texto_marcador, 4, 2, 25, COLOR_POINT);
+        llamadas++;
+    }
+#ifdef TRAZAS
+    if (mostrar_traza && texto_traza[0] != '\0') {
+        dibujar_texto(texto_traza, 4, 30, 25, COLOR_POINT);
+        llamadas++;
+    }
+#endif
+    return llamadas;
+}
+
+
+// ========================= Función dibujar_mensaje =========================
+// Función para mostrar un mensaje de texto en pantalla, centrado
+// Recibe el mapa, el mensaje de texto, y el color del texto
+// No espera: el tiempo que el mensaje queda en pantalla lo controlan las transiciones
+void dibujar_mensaje(Mapa* mapa, const char* mensaje, SDL_Color color) {
+    // Limpia la pantalla y establece el color de fondo a negro
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    // Dibuja el texto centrado en pantalla, desde el atlas de glifos
+    if (texto_iniciar()) {
+        int text_width = texto_ancho(mensaje, 100);
+        dibujar_texto(mensaje,
+                      ((mapa->columnas * TILE_SIZE) - text_width) / 2,  // Posición X centrada
+                      (mapa->filas * TILE_SIZE) / 2,                    // Posición Y centrada
+                      100, color);
+    }
+    SDL_RenderPresent(renderer); // Muestra el renderizado en pantalla
+}
+
+
+
+
+// ========================= Función tamano_ventana =========================
+// Calcula el tamaño de la ventana para un mapa: una celda de TILE_SIZE píxeles,
+// achicando todo (sin deformar) si el mapa no entra en la pantalla
+void tamano_ventana(const Mapa* mapa, int* ancho, int* alto) {
+    *ancho = mapa->columnas * TILE_SIZE;
+    *alto = mapa->filas * TILE_SIZE;
+    SDL_Rect pantalla;
+    if (SDL_GetDisplayUsableBounds(0, &pantalla) == 0 && (*ancho > pantalla.w || *alto > pantalla.h)) {
+        double escala_x = (double)pantalla.w / *ancho, escala_y = (double)pantalla.h / *alto;
+        double escala = escala_x < escala_y ? escala_x : escala_y;
+        *ancho = (int)(*ancho * escala);
+        *alto = (int)(*alto * escala);
+    }
+}
+
+// =========================== Función iniciar_SDL ===========================
+// Función para inicializar SDL y crear la ventana y el renderizador, una sola vez para todo el juego
+// Recibe un puntero al mapa ya cargado para ajustar el tamaño inicial de la ventana
+int iniciar_SDL(const Mapa* mapa) {
+    
+    // Inicializar SDL con el subsistema de video
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        // Si falla la inicialización, muestra el error y retorna -1
+        printf("Error al iniciar SDL: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    // Crear una ventana para el juego Pac-Man con las dimensiones basadas en el mapa
+    int ancho, alto;
+    tamano_ventana(mapa, &ancho, &alto);
+    window = SDL_CreateWindow(
+        "Pacman con SDL2",               // Título de la ventana
+        SDL_WINDOWPOS_UNDEFINED,         // Posición X de la ventana (centrada)
+        SDL_WINDOWPOS_UNDEFINED,         // Posición Y de la ventana (centrada)
+        ancho,                           // Ancho de la ventana (columnas * tamaño de celda)
+        alto,                            // Alto de la ventana (filas * tamaño de celda)
+        SDL_WINDOW_SHOWN |               // Mostrar ventana al crearla
+        SDL_WINDOW_RESIZABLE             // Permitir cambiar su tamaño (el juego se escala)
+    );
+
+    // Verificar si la ventana se creó correctamente
+    if (!window) {
+        // Si falla la creación de la ventana, muestra el error, cierra SDL y retorna -1
+        printf("Error al crear la ventana: %s\n", SDL_GetError());
+        SDL_Quit();
+        return -1;
+    }
+
+    // Crear el renderizador para dibujar en la ventana
+    // Sin límite de FPS explícito, se sincroniza la presentación con el vsync del monitor
+    renderer = SDL_CreateRenderer(
+        window,                          // Ventana asociada
+        -1,                              // Índice del driver (-1 para usar el primero disponible)
+        SDL_RENDERER_ACCELERATED |       // Utilizar renderizado acelerado por hardware
+        (limite_fps == 0 ? SDL_RENDERER_PRESENTVSYNC : 0)
+    );
+
+    // Verificar si el renderizador se creó correctamente
+    if (!renderer) {
+        // Si falla la creación del renderizador, muestra el error, destruye la ventana, cierra SDL y retorna -1
+        printf("Error al crear el renderizador: %s\n", SDL_GetError());
+        SDL_DestroyWindow(window);       // Destruir la ventana creada previamente
+        SDL_Quit();                      // Cerrar SDL
+        return -1;
+    }
+
+    // Si se pidió vsync pero el driver no lo ofrece, se limitan los FPS para no dibujar sin pausa
+    SDL_RendererInfo info;
+    if (limite_fps == 0 && SDL_GetRendererInfo(renderer, &info) == 0 &&
+        !(info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        limite_fps = FPS_SIN_VSYNC;
+    }
+
+    // Tamaño lógico del primer mapa: el dibujo se escala al tamaño real de la ventana
+    SDL_RenderSetLogicalSize(renderer, mapa->columnas * TILE_SIZE, mapa->filas * TILE_SIZE);
+
+    // Si todo se inicializó correctamente, retorna 0
+    return 0;
+}
+
+// ========================= Función ajustar_ventana =========================
+// Ajusta la ventana y el tamaño lógico del renderizador a un nuevo mapa,
+// conservando la ventana, el renderizador y sus texturas
+void ajustar_ventana(const Mapa* mapa) {
+    int ancho = mapa->columnas * TILE_SIZE, alto = mapa->filas * TILE_SIZE;
+    int logico_ancho = 0, logico_alto = 0;
+    SDL_RenderGetLogicalSize(renderer, &logico_ancho, &logico_alto);
+    if (logico_ancho != ancho || logico_alto != alto) {
+        int ancho_ventana, alto_ventana;
+        tamano_ventana(mapa, &ancho_ventana, &alto_ventana);
+        SDL_SetWindowSize(window, ancho_ventana, alto_ventana);
+        SDL_RenderSetLogicalSize(renderer, ancho, alto);
+    }
+}
+
+
+
+// ======================= Función dibujar_rectangulo =======================
+// Función para dibujar un rectángulo en la posición especificada con un color dado
+// Parámetros:
+//   x, y: Coordenadas del rectángulo en el mapa
+//   porcentaje: Tamaño del rectángulo como un porcentaje del tamaño de una celda (TILE_SIZE)
+//   color: Color del rectángulo (estructura SDL_Color)
+void dibujar_rectangulo(int x, int y, int porcentaje, SDL_Color color) {
+    // Establece el color para el renderizador
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+
+    // Calcula el tamaño del rectángulo basado en el porcentaje
+    int size = (TILE_SIZE * porcentaje) / 100; 
+    int offset = (TILE_SIZE - size) / 2; // Calcula el desplazamiento para centrar el rectángulo
+
+    // Define el rectángulo a dibujar
+    SDL_Rect rect = {x * TILE_SIZE + offset, y * TILE_SIZE + offset, size, size};
+
+    // Dibuja el rectángulo relleno
+    SDL_RenderFillRect(renderer, &rect);
+}
+
+
+
+// =========================== Lote de Dibujo ===========================
+// Agrupa los rectángulos de la escena por color y los envía con una sola
+// llamada a SDL_RenderFillRects por color, en lugar de cambiar el color y
+// llamar a SDL_RenderFillRect por cada celda. Los grupos se envían en orden
+// (fondo, obstáculos, puntos, Pac-Man, fantasmas), así los personajes
+// quedan por encima del laberinto como en el dibujo original.
+
+enum ColorLote { LOTE_FONDO, LOTE_OBSTACULO, LOTE_PUNTO, LOTE_PACMAN, LOTE_FANTASMA, CANT_COLORES_LOTE };
+
+// Tamaño de cada tipo de rectángulo como porcentaje de la celda
+#define PORCENTAJE_CELDA 100
+#define PORCENTAJE_PUNTO 10
+#define PORCENTAJE_PACMAN 85
+#define PORCENTAJE_FANTASMA 75
+
+// Rectángulos por color; si un grupo se llena, se envía todo lo acumulado y se sigue
+#define CAPACIDAD_LOTE 1024
+
+typedef struct {
+    SDL_Rect rects[CAPACIDAD_LOTE];     // Rectángulos pendientes de este color
+    int cantidad;
+} GrupoRectangulos;
+
+// Los arreglos se reutilizan de un cuadro a otro
+GrupoRectangulos lote_dibujo[CANT_COLORES_LOTE];
+
+// Estadísticas de dibujo de los cuadros del juego (--estadisticas)
+typedef struct {
+    Uint64 cuadros;             // Cuadros dibujados
+    Uint64 llamadas;            // Llamadas de dibujo en total
+    int llamadas_max;           // Máximo de llamadas en un cuadro
+    int llamadas_cuadro;        // Llamadas del cuadro en curso
+    Uint64 tiempo_total;        // Tiempo de dibujo acumulado (cuentas del contador de rendimiento)
+    Uint64 tiempo_max;          // Máximo tiempo de dibujo en un cuadro
+    int cambios_nivel;          // Cambios de nivel medidos
+    Uint64 tiempo_cambios;      // Tiempo acumulado desde el fin de un nivel hasta el primer cuadro del siguiente
+    Uint64 tiempo_cambio_max;   // Máximo tiempo de un cambio de nivel
+} EstadisticasDibujo;
+
+EstadisticasDibujo estadisticas_dibujo = {0};
+bool mostrar_estadisticas = false;
+
+// Calcula el rectángulo de la celda (x, y) con el tamaño indicado, centrado en la celda
+static inline SDL_Rect rectangulo_celda(int x, int y, int porcentaje) {
+    int size = (TILE_SIZE * porcentaje) / 100;
+    int offset = (TILE_SIZE - size) / 2;
+    SDL_Rect rect = {x * TILE_SIZE + offset, y * TILE_SIZE + offset, size, size};
+    return rect;
+}
+
+// Envía todos los grupos pendientes (una llamada por color no vacío) y los vacía
+void lote_enviar(void) {
+    static const SDL_Color* colores[CANT_COLORES_LOTE] = {
+        &COLOR_FONDO, &COLOR_OBSTACLE, &COLOR_POINT, &COLOR_PACMAN, &COLOR_GHOST
+    };
+    for (int c = 0; c < CANT_COLORES_LOTE; c++) {
+        GrupoRectangulos* grupo = &lote_dibujo[c];
+        if (grupo->cantidad == 0) {
+            continue;
+        }
+        SDL_SetRenderDrawColor(renderer, colores[c]->r, colores[c]->g, colores[c]->b, colores[c]->a);
+        SDL_RenderFillRects(renderer, grupo->rects, grupo->cantidad);
+        estadisticas_dibujo.llamadas_cuadro++;
+        grupo->cantidad = 0;
+    }
+}
+
+// Agrega un rectángulo al grupo de un color
+static inline void lote_agregar(enum ColorLote color, int x, int y, int porcentaje) {
+    GrupoRectangulos* grupo = &lote_dibujo[color];
+    if (grupo->cantidad == CAPACIDAD_LOTE) {
+        lote_enviar(); // Se envían todos los grupos, en orden, para respetar qué queda encima
+    }
+    grupo->rects[grupo->cantidad++] = rectangulo_celda(x, y, porcentaje);
+}
+
+// Cierra las estadísticas de un cuadro que empezó en "inicio"
+void estadisticas_cerrar_cuadro(Uint64 inicio) {
+    Uint64 tiempo = SDL_GetPerformanceCounter() - inicio;
+    EstadisticasDibujo* e = &estadisticas_dibujo;
+    e->cuadros++;
+    e->llamadas += e->llamadas_cuadro;
+    if (e->llamadas_cuadro > e->llamadas_max) {
+        e->llamadas_max = e->llamadas_cuadro;
+    }
+    e->llamadas_cuadro = 0;
+    e->tiempo_total += tiempo;
+    if (tiempo > e->tiempo_max) {
+        e->tiempo_max = tiempo;
+    }
+}
+
+// Registra un cambio de nivel que empezó en "inicio"
+void estadisticas_cambio_nivel(Uint64 inicio) {
+    Uint64 tiempo = SDL_GetPerformanceCounter() - inicio;
+    EstadisticasDibujo* e = &estadisticas_dibujo;
+    e->cambios_nivel++;
+    e->tiempo_cambios += tiempo;
+    if (tiempo > e->tiempo_cambio_max) {
+        e->tiempo_cambio_max = tiempo;
+    }
+}
+
+// Imprime el resumen de las estadísticas de dibujo
+void estadisticas_imprimir(void) {
+    const EstadisticasDibujo* e = &estadisticas_dibujo;
+    if (e->cuadros == 0) {
+        return;
+    }
+    double ms_por_cuenta = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    printf("Cuadros: %llu, llamadas de dibujo por cuadro: %.1f (máx. %d), tiempo de dibujo: %.3f ms (máx. %.3f ms)\n",
+           (unsigned long long)e->cuadros, (double)e->llamadas / e->cuadros, e->llamadas_max,
+           e->tiempo_total * ms_por_cuenta / e->cuadros, e->tiempo_max * ms_por_cuenta);
+    if (e->cambios_nivel > 0) {
+        printf("Cambios de nivel: %d, tiempo hasta el primer cuadro: %.3f ms (máx. %.3f ms)\n",
+               e->cambios_nivel, e->tiempo_cambios * ms_por_cuenta / e->cambios_nivel,
+               e->tiempo_cambio_max * ms_por_cuenta);
+    }
+}
+
+
+// ========================= Caché de la Escena =========================
+// La escena (laberinto, puntos y personajes) se mantiene en una textura que
+// conserva lo dibujado en el cuadro anterior. El laberinto se dibuja completo
+// una sola vez por nivel y, en cada cuadro, solo se vuelven a dibujar las
+// celdas que cambiaron: los puntos comidos y las posiciones anterior y nueva
+// de Pac-Man y los fantasmas. Luego la textura se copia entera a la ventana.
+
+// Personajes a dibujar: Pac-Man y los fantasmas del nivel, que pueden ser cualquier cantidad
+typedef struct {
+    Posicion pacman;                        // Posición de Pac-Man
+    const Posicion* fantasmas;              // Posiciones de los fantasmas
+    int cant_fantasmas;                     // Cantidad de fantasmas
+} Personajes;
+
+typedef struct {
+    SDL_Texture* textura;                   // Escena del cuadro anterior (NULL si no hay textura)
+    int ancho, alto;                        // Tamaño de la textura (puede ser mayor que el mapa)
+    const Mapa* mapa;                       // Mapa dibujado en la textura
+    char* puntos_dibujados;                 // 1 por cada punto del índice del mapa que está dibujado
+    int capacidad_puntos;                   // Capacidad de "puntos_dibujados"
+    int puntos_restantes;                   // Puntos que quedaban en el cuadro anterior
+    Posicion* personajes;                   // Posiciones dibujadas de Pac-Man (la primera) y los fantasmas
+    int cant_personajes;                    // Personajes dibujados
+    Posicion* sucias;                       // Celdas a redibujar en el cuadro actual
+    int capacidad_personajes;               // Capacidad de "personajes" (y de "sucias", más MAX_CELDAS_SUCIAS)
+    Uint32* marcas;                         // Cuadro en que se marcó cada celda del mapa (evita repetidas en "sucias")
+    int capacidad_marcas;                   // Capacidad de "marcas"
+    Uint32 cuadro;                          // Número de cuadro actual para "marcas" (nunca 0)
+    bool valida;                            // false si la textura debe redibujarse completa
+    bool sin_soporte;                       // true si el renderizador no puede dibujar en texturas
+} CacheEscena;
+
+// Máximo de celdas de puntos comidos que se redibujan por separado en un cuadro; si cambian más, se redibuja todo
+#define MAX_CELDAS_SUCIAS 64
+
+CacheEscena cache_escena = {0};
+
+// Fuerza a redibujar la escena completa en el próximo cuadro (por ejemplo, al cambiar de nivel)
+void escena_invalidar(void) {
+    cache_escena.valida = false;
+}
+
+// Libera la textura de la escena (antes de destruir el renderizador o si se perdió su contenido)
+void escena_liberar(void) {
+    if (cache_escena.textura != NULL) {
+        SDL_DestroyTexture(cache_escena.textura);
+    }
+    cache_escena.textura = NULL;
+    cache_escena.sin_soporte = false;
+    cache_escena.valida = false;
+    free(cache_escena.puntos_dibujados);
+    cache_escena.puntos_dibujados = NULL;
+    cache_escena.capacidad_puntos = 0;
+    free(cache_escena.personajes);
+    free(cache_escena.sucias);
+    free(cache_escena.marcas);
+    cache_escena.personajes = NULL;
+    cache_escena.sucias = NULL;
+    cache_escena.marcas = NULL;
+    cache_escena.capacidad_marcas = 0;
+    cache_escena.cant_personajes = 0;
+    cache_escena.capacidad_personajes = 0;
+}
+
+// Contenido a dibujar en una celda: los puntos salen del índice del nivel y no de las celdas del mapa
+static inline char contenido_celda(const Mapa* mapa, const PuntosNivel* puntos, int indice) {
+    if (puntos_hay(puntos, indice)) {
+        return POINT;
+    }
+    return mapa->celdas[indice] == OBSTACLE ? OBSTACLE : PATH;
+}
+
+// Agrega al lote el fondo de una celda (vacío, obstáculo o punto) según el contenido indicado
+void dibujar_celda(int x, int y, char contenido) {
+    if (contenido == OBSTACLE) {
+        lote_agregar(LOTE_OBSTACULO, x, y, PORCENTAJE_CELDA);
+    } else {
+        lote_agregar(LOTE_FONDO, x, y, PORCENTAJE_CELDA);
+        if (contenido == POINT) {
+            lote_agregar(LOTE_PUNTO, x, y, PORCENTAJE_PUNTO);
+        }
+    }
+}
+
+// Agrega al lote a Pac-Man y los fantasmas (los fantasmas se dibujan encima de Pac-Man)
+void dibujar_personajes(const Personajes* personajes) {
+    lote_agregar(LOTE_PACMAN, personajes->pacman.x, personajes->pacman.y, PORCENTAJE_PACMAN);
+    for (int i = 0; i < personajes->cant_fantasmas; i++) {
+        lote_agregar(LOTE_FANTASMA, personajes->fantasmas[i].x, personajes->fantasmas[i].y, PORCENTAJE_FANTASMA);
+    }
+}
+
+// Crea la textura de la escena si hace falta
+// Retorna: true si se puede dibujar sobre la textura
+bool escena_preparar(const Mapa* mapa, int cant_personajes) {
+    if (cache_escena.sin_soporte) {
+        return false;
+    }
+    // La textura se reutiliza entre niveles; solo se crea otra si el mapa no entra en ella
+    int ancho = mapa->columnas * TILE_SIZE, alto = mapa->filas * TILE_SIZE;
+    if (cache_escena.textura != NULL && (cache_escena.ancho < ancho || cache_escena.alto < alto)) {
+        escena_liberar();
+    }
+    if (cache_escena.textura == NULL) {
+        if (!SDL_RenderTargetSupported(renderer) ||
+            (cache_escena.textura = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                                      ancho, alto)) == NULL) {
+            // Sin texturas de destino se sigue dibujando la escena completa en cada cuadro
+            cache_escena.sin_soporte = true;
+            return false;
+        }
+        SDL_AtomicIncRef(&asignaciones);
+        cache_escena.ancho = ancho;
+        cache_escena.alto = alto;
+        cache_escena.valida = false;
+    }
+    if (cache_escena.mapa != mapa) {
+        cache_escena.mapa = mapa;
+        cache_escena.valida = false;
+    }
+
+    // Un indicador por punto del mapa, para saber cuáles siguen dibujados
+    if (cache_escena.capacidad_puntos < mapa->puntos_totales) {
+        char* puntos = realloc(cache_escena.puntos_dibujados, mapa->puntos_totales);
+        if (puntos == NULL) {
+            return false;
+        }
+        SDL_AtomicIncRef(&asignaciones);
+        cache_escena.puntos_dibujados = puntos;
+        cache_escena.capacidad_puntos = mapa->puntos_totales;
+    }
+
+    // Una marca por celda del mapa, para no repetir celdas sucias en un cuadro
+    if (cache_escena.capacidad_marcas < mapa_celdas(mapa)) {
+        Uint32* marcas = realloc(cache_escena.marcas, mapa_celdas(mapa) * sizeof(Uint32));
+        if (marcas == NULL) {
+            return false;
+        }
+        SDL_AtomicIncRef(&asignaciones);
+        memset(marcas, 0, mapa_celdas(mapa) * sizeof(Uint32));
+        cache_escena.marcas = marcas;
+        cache_escena.capacidad_marcas = mapa_celdas(mapa);
+        cache_escena.cuadro = 0;
+    }
+
+    // Posiciones dibujadas de cada personaje y lugar para sus celdas anterior y nueva
+    if (cache_escena.capacidad_personajes < cant_personajes) {
+        Posicion* personajes = realloc(cache_escena.personajes, cant_personajes * sizeof(Posicion));
+        if (personajes == NULL) {
+            return false;
+        }
+        cache_escena.personajes = personajes;
+        Posicion* sucias = realloc(cache_escena.sucias, (MAX_CELDAS_SUCIAS + 2 * cant_personajes) * sizeof(Posicion));
+        if (sucias == NULL) {
+            return false;
+        }
+        SDL_AtomicAdd(&asignaciones, 2);
+        cache_escena.sucias = sucias;
+        cache_escena.capacidad_personajes = cant_personajes;
+    }
+    if (cache_escena.cant_personajes != cant_personajes) {
+        cache_escena.cant_personajes = cant_personajes;
+        cache_escena.valida = false;
+    }
+    return true;
+}
+
+// Dibuja la escena completa en el destino actual del renderizador
+void dibujar_escena_completa(const Mapa* mapa, const PuntosNivel* puntos, const Personajes* personajes) {
+    // Limpia el destino y establece el color de fondo a negro
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    estadisticas_dibujo.llamadas_cuadro++;
+
+    // Obstáculos (bloques del tamaño de la celda), recorriendo los bits encendidos de la máscara de paredes
+    // (las celdas vacías ya quedaron en negro y las paredes de relleno no se dibujan)
+    int celdas = mapa_celdas(mapa);
+    for (int palabra = 0; palabra * 64 < celdas; palabra++) {
+        Uint64 bits = mapa->paredes[palabra];
+        for (int b = 0; bits != 0; b++, bits >>= 1) { // Las palabras sin paredes se saltean enteras
+            int indice = palabra * 64 + b;
+            if ((bits & 1) && indice % mapa->paso < mapa->columnas) {
+                lote_agregar(LOTE_OBSTACULO, indice % mapa->paso, indice / mapa->paso, PORCENTAJE_CELDA);
+            }
+        }
+    }
+
+    // Puntos que quedan, con un tamaño más pequeño (10% de la celda), recorriendo el índice de puntos
+    for (int k = 0; k < mapa->puntos_totales; k++) {
+        int indice = mapa->puntos[k];
+        bool dibujado = puntos_hay(puntos, indice);
+        if (dibujado) {
+            lote_agregar(LOTE_PUNTO, indice % mapa->paso, indice / mapa->paso, PORCENTAJE_PUNTO);
+        }
+        if (cache_escena.capacidad_puntos >= mapa->puntos_totales) {
+            cache_escena.puntos_dibujados[k] = dibujado;
+        }
+    }
+    cache_escena.puntos_restantes = puntos->restantes;
+    dibujar_personajes(personajes);
+    lote_enviar();
+}
+
+// Marca una celda para redibujar (sin repetidas: la celda guarda el número del cuadro que la marcó)
+static void marcar_celda(const Mapa* mapa, Posicion sucias[], int* cantidad, Posicion celda) {
+    Uint32* marca = &cache_escena.marcas[mapa_indice(mapa, celda.x, celda.y)];
+    if (*marca != cache_escena.cuadro) {
+        *marca = cache_escena.cuadro;
+        sucias[(*cantidad)++] = celda;
+    }
+}
+
+// ========================= Función componer_juego =========================
+// Función para dibujar el mapa, los puntos que quedan, Pac-Man y los fantasmas
+// en la ventana, sin presentarla. Solo lee el estado del juego: no lo modifica
+void componer_juego(const Mapa* mapa, const PuntosNivel* puntos, const Personajes* personajes) {
+    Posicion pacman = personajes->pacman;
+    int cant_personajes = 1 + personajes->cant_fantasmas;
+    Uint64 inicio = SDL_GetPerformanceCounter();
+
+    // Sin textura de escena, se dibuja todo directamente en la ventana
+    if (!escena_preparar(mapa, cant_personajes)) {
+        dibujar_escena_completa(mapa, puntos, personajes);
+        estadisticas_dibujo.llamadas_cuadro += dibujar_marcador();
+        estadisticas_cerrar_cuadro(inicio);
+        return;
+    }
+
+    SDL_SetRenderTarget(renderer, cache_escena.textura);
+
+    // Celdas a redibujar: las de los puntos comidos (solo los puntos cambian
+    // durante el nivel, así que basta con recorrer el índice de puntos, y solo
+    // en los cuadros en que bajó la cantidad que queda) y las que ocupaban o
+    // pasan a ocupar los personajes que se movieron
+    Posicion* sucias = cache_escena.sucias;
+    int cant_sucias = 0;
+    if (++cache_escena.cuadro == 0) {
+        // El contador dio la vuelta: se borran las marcas viejas para que no coincidan
+        memset(cache_escena.marcas, 0, cache_escena.capacidad_marcas * sizeof(Uint32));
+        cache_escena.cuadro = 1;
+    }
+    bool comidos = cache_escena.puntos_restantes != puntos->restantes;
+    for (int k = 0; k < mapa->puntos_totales && cache_escena.valida && comidos; k++) {
+        if (cache_escena.puntos_dibujados[k] && !puntos_hay(puntos, mapa->puntos[k])) {
+            cache_escena.puntos_dibujados[k] = 0;
+            int indice = mapa->puntos[k];
+            if (cant_sucias == MAX_CELDAS_SUCIAS) {
+                cache_escena.valida = false; // Demasiados cambios: conviene redibujar todo
+            } else {
+                marcar_celda(mapa, sucias, &cant_sucias, (Posicion){indice % mapa->paso, indice / mapa->paso});
+            }
+        }
+    }
+
+    if (!cache_escena.valida) {
+        // Primer cuadro del nivel: se hornea el laberinto completo en la textura
+        dibujar_escena_completa(mapa, puntos, personajes);
+        cache_escena.valida = true;
+    } else {
+        // Solo cambian las celdas de los personajes que se movieron; los que quedaron
+        // quietos se vuelven a dibujar igual encima, por si compartían una celda sucia
+        // (entran siempre: "sucias" tiene lugar para dos celdas por personaje)
+        for (int i = 0; i < cant_personajes; i++) {
+            Posicion actual = i == 0 ? pacman : personajes->fantasmas[i - 1];
+            Posicion anterior = cache_escena.personajes[i];
+            if (anterior.x != actual.x || anterior.y != actual.y) {
+                marcar_celda(mapa, sucias, &cant_sucias, anterior);
+                marcar_celda(mapa, sucias, &cant_sucias, actual);
+            }
+        }
+
+        // Redibuja el fondo de las celdas sucias y luego los personajes encima
+        for (int i = 0; i < cant_sucias; i++) {
+            dibujar_celda(sucias[i].x, sucias[i].y, contenido_celda(mapa, puntos, mapa_indice(mapa, sucias[i].x, sucias[i].y)));
+        }
+        if (cant_sucias > 0) {
+            dibujar_personajes(personajes);
+        }
+        lote_enviar();
+        cache_escena.puntos_restantes = puntos->restantes;
+    }
+    cache_escena.personajes[0] = pacman;
+    memcpy(cache_escena.personajes + 1, personajes->fantasmas, personajes->cant_fantasmas * sizeof(Posicion));
+
+    // Copia la escena a la ventana y la muestra en pantalla
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_Rect area = {0, 0, mapa->columnas * TILE_SIZE, mapa->filas * TILE_SIZE};
+    SDL_RenderCopy(renderer, cache_escena.textura, &area, NULL);
+    estadisticas_dibujo.llamadas_cuadro++;
+
+    // El marcador se dibuja sobre la ventana y no en la textura, así no ensucia celdas
+    estadisticas_dibujo.llamadas_cuadro += dibujar_marcador();
+    estadisticas_cerrar_cuadro(inicio); // El tiempo de dibujo no incluye la espera del vsync
+}
+
+// ========================= Función dibujar_juego =========================
+// Función para dibujar el mapa, Pac-Man y los fantasmas, y mostrarlos en pantalla
+void dibujar_juego(const Mapa* mapa, const PuntosNivel* puntos, const Personajes* personajes) {
+    componer_juego(mapa, puntos, personajes);
+    SDL_RenderPresent(renderer);
+}
+
+
+
+// =========================== Función cerrar_SDL ===========================
+// Destruye las texturas, el renderizador y la ventana al terminar el juego
+void cerrar_SDL(void) {
+    escena_liberar();
+    texto_liberar_textura();
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+}
+
+
+
+// ============================ Transiciones ============================
+// Los mensajes, la animación de muerte y el sonido de inicio son estados con
+// duración que se procesan dentro del bucle principal: en cada cuadro se
+// dibuja el estado actual y se siguen atendiendo los eventos de la ventana,
+// en lugar de bloquear el programa con SDL_Delay.
+
+#define MAX_TRANSICIONES 8              // Transiciones encoladas como máximo
+#define DURACION_MENSAJE_MS 2000        // Tiempo en pantalla de cada mensaje
+#define DURACION_INTRO_MS 4200          // Duración del sonido de inicio
+#define PASO_ANIMACION_MUERTE_MS 50     // Tiempo entre cuadros de la animación de muerte
+#define TAMANO_INICIAL_MUERTE 90        // Tamaño de Pac-Man (en % de la celda) al empezar a morir
+#define DURACION_MUERTE_MS (((TAMANO_INICIAL_MUERTE - 5) / 5) * PASO_ANIMACION_MUERTE_MS)
+
+enum TipoTransicion { TRANSICION_MENSAJE, TRANSICION_MUERTE };
+
+typedef struct {
+    enum TipoTransicion tipo;
+    const char* texto;          // Texto del mensaje
+    SDL_Color color;            // Color del texto
+    Uint32 duracion_ms;         // Tiempo que dura la transición
+    enum Sonido sonido;         // Sonido que se reproduce al comenzar (o SONIDO_NINGUNO)
+} Transicion;
+
+// Cola circular de transiciones: se muestran una tras otra
+typedef struct {
+    Transicion cola[MAX_TRANSICIONES];
+    int primera, cantidad;
+    bool comenzada;             // true si la primera transición ya empezó
+    Uint32 comienzo;            // Momento en que empezó la primera transición (SDL_GetTicks)
+} ColaTransiciones;
+
+// Encola una transición
+void transicion_agregar(ColaTransiciones* cola, enum TipoTransicion tipo, const char* texto, SDL_Color color,
+                        Uint32 duracion_ms, enum Sonido sonido) {
+    if (cola->cantidad == MAX_TRANSICIONES) {
+        return;
+    }
+    Transicion* t = &cola->cola[(cola->primera + cola->cantidad) % MAX_TRANSICIONES];
+    t->tipo = tipo;
+    t->texto = texto;
+    t->color = color;
+    t->duracion_ms = duracion_ms;
+    t->sonido = sonido;
+    cola->cantidad++;
+}
+
+// Encola un mensaje con la duración habitual
+void transicion_mensaje(ColaTransiciones* cola, const char* texto, SDL_Color color) {
+    transicion_agregar(cola, TRANSICION_MENSAJE, texto, color, DURACION_MENSAJE_MS, SONIDO_NINGUNO);
+}
+
+// Retorna: true si hay una transición en curso o pendiente
+bool transiciones_activas(const ColaTransiciones* cola) {
+    return cola->cantidad > 0;
+}
+
+// Dibuja un cuadro de la animación de muerte: Pac-Man se achica sobre la escena
+void dibujar_animacion_muerte(Mapa* mapa, const PuntosNivel* puntos, const Personajes* personajes, Uint32 transcurrido) {
+    int tamano = TAMANO_INICIAL_MUERTE - 5 * (int)(transcurrido / PASO_ANIMACION_MUERTE_MS);
+
+    // Dibuja el estado actual del juego y limpia la posición de Pac-Man
+    Posicion pacman = personajes->pacman;
+    componer_juego(mapa, puntos, personajes);
+    dibujar_rectangulo(pacman.x, pacman.y, 100, COLOR_FONDO);
+
+    // Dibuja Pac-Man con un tamaño decreciente
+    if (tamano > 5) {
+        dibujar_rectangulo(pacman.x, pacman.y, tamano, COLOR_PACMAN);
+    }
+    SDL_RenderPresent(renderer);
+}
+
+// ===================== Función transiciones_actualizar =====================
+// Avanza la cola de transiciones según el tiempo transcurrido y dibuja la actual
+// Parámetros:
+//   mapa: Mapa del nivel (para centrar los mensajes y dibujar la escena)
+//   puntos: Puntos que quedan en el nivel (para la animación de muerte)
+//   personajes: Posiciones de Pac-Man y los fantasmas (para la animación de muerte)
+void transiciones_actualizar(ColaTransiciones* cola, Mapa* mapa, const PuntosNivel* puntos, const Personajes* personajes) {
+    Uint32 ahora = SDL_GetTicks();
+
+    // Comienza la primera transición o pasa a la siguiente si ya terminó
+    while (cola->cantidad > 0) {
+        Transicion* t = &cola->cola[cola->primera];
+        if (!cola->comenzada) {
+            cola->comenzada = true;
+            cola->comienzo = ahora;
+            audio_reproducir(t->sonido);
+        }
+        if (ahora - cola->comienzo < t->duracion_ms) {
+            break;
+        }
+        cola->primera = (cola->primera + 1) % MAX_TRANSICIONES;
+        cola->cantidad--;
+        cola->comenzada = false;
+    }
+    if (cola->cantidad == 0) {
+        return;
+    }
+
+    const Transicion* t = &cola->cola[cola->primera];
+    switch (t->tipo) {
+        case TRANSICION_MENSAJE:
+            dibujar_mensaje(mapa, t->texto, t->color);
+            break;
+        case TRANSICION_MUERTE:
+            dibujar_animacion_muerte(mapa, puntos, personajes, ahora - cola->comienzo);
+            break;
+    }
+}
+
+
+
+// ========================== Reloj de Simulación ==========================
+// Reloj de paso fijo: acumula el tiempo real medido con el contador de alto
+// rendimiento y lo convierte en ticks de PASO_SIMULACION_MS. Así la lógica
+// avanza a la misma velocidad en cualquier equipo, independientemente de la
+// resolución del temporizador del sistema o de lo que tarde en dibujarse un cuadro.
+typedef struct {
+    Uint64 cuentas_por_tick;     // Cuentas del contador de alto rendimiento por tick
+    Uint64 anterior;             // Lectura del contador en la consulta anterior
+    Uint64 acumulador;           // Tiempo real todavía no simulado (en cuentas)
+} RelojSimulacion;
+
+// ===================== Función reloj_iniciar =====================
+// Pone el reloj en cero; se llama justo antes de empezar a simular un nivel
+void reloj_iniciar(RelojSimulacion* reloj) {
+    reloj->cuentas_por_tick = SDL_GetPerformanceFrequency() * PASO_SIMULACION_MS / 1000;
+    if (reloj->cuentas_por_tick == 0) {
+        reloj->cuentas_por_tick = 1;
+    }
+    reloj->anterior = SDL_GetPerformanceCounter();
+    reloj->acumulador = 0;
+}
+
+// ================= Función reloj_ticks_pendientes =================
+// Suma el tiempo real transcurrido desde la última consulta y devuelve
+// cuántos ticks de simulación hay que ejecutar para ponerse al día
+int reloj_ticks_pendientes(RelojSimulacion* reloj) {
+    Uint64 ahora = SDL_GetPerformanceCounter();
+    reloj->acumulador += ahora - reloj->anterior;
+    reloj->anterior = ahora;
+
+    Uint64 ticks = reloj->acumulador / reloj->cuentas_por_tick;
+    reloj->acumulador -= ticks * reloj->cuentas_por_tick;
+
+    // Si hubo una pausa muy larga, se descarta el excedente en lugar de simularlo
+    if (ticks > MAX_TICKS_POR_CUADRO) {
+        ticks = MAX_TICKS_POR_CUADRO;
+    }
+    return (int)ticks;
+}
+
+// ======================= Función esperar_hasta =======================
+// Duerme hasta que el contador de alto rendimiento alcance "objetivo".
+// Usa SDL_Delay para casi toda la espera y solo consulta el contador
+// durante el último milisegundo, que el temporizador del sistema no resuelve.
+void esperar_hasta(Uint64 objetivo) {
+    Uint64 frecuencia = SDL_GetPerformanceFrequency();
+    for (;;) {
+        Uint64 ahora = SDL_GetPerformanceCounter();
+        if (ahora >= objetivo) {
+            return;
+        }
+        Uint64 restante_ms = (objetivo - ahora) * 1000 / frecuencia;
+        if (restante_ms > 1) {
+            SDL_Delay((Uint32)(restante_ms - 1));
+        }
+    }
+}
+
+
+
+// ========================== Trazas por Cuadro ==========================
+// Instrumentación del bucle del nivel que solo existe si se compila con
+// -DTRAZAS: sin esa definición las macros no generan código. Cada cuadro
+// registra cuánto tardó cada etapa (eventos, simulación, transiciones,
+// dibujo, presentación y espera), los ticks simulados, los nodos que
+// expandió A* y las llamadas de dibujo. Los cuadros se guardan en un anillo
+// sin bloqueos: el hilo del juego escribe y publica cada cuadro con una suma
+// atómica, y quien lee detecta los cuadros que se pisaron mientras los copiaba.
+// Al terminar, el anillo se exporta en el formato de trazas de Chrome
+// (--traza=archivo, se abre en chrome://tracing o Perfetto) y, con
+// --traza-overlay, los números del último cuadro se muestran en pantalla.
+#ifdef TRAZAS
+
+enum EtapaCuadro { ETAPA_EVENTOS, ETAPA_SIMULACION, ETAPA_TRANSICIONES, ETAPA_DIBUJO, ETAPA_PRESENTAR, ETAPA_ESPERA, CANT_ETAPAS };
+static const char* nombres_etapas[CANT_ETAPAS] = {"eventos", "simulacion", "transiciones", "dibujo", "presentar", "espera"};
+
+#define CAPACIDAD_TRAZA 16384   // Cuadros que guarda el anillo (unos 4 minutos a 60 FPS); potencia de 2
+
+// Mediciones de un cuadro (los tiempos en microsegundos desde el inicio del cuadro)
+typedef struct {
+    Uint64 inicio;                      // Contador de rendimiento al empezar el cuadro
+    Uint32 desde[CANT_ETAPAS];          // Comienzo de cada etapa
+    Uint32 duracion[CANT_ETAPAS];       // Duración de cada etapa (0 si no ocurrió en el cuadro)
+    Uint32 total;                       // Duración del cuadro completo
+    Uint32 ticks;                       // Ticks simulados
+    Uint32 nodos;                       // Nodos expandidos por A*
+    Uint32 llamadas;                    // Llamadas de dibujo
+} CuadroTraza;
+
+typedef struct {
+    CuadroTraza cuadros[CAPACIDAD_TRAZA];
+    SDL_atomic_t escritos;              // Cuadros publicados desde el inicio (solo lo incrementa el hilo del juego)
+    CuadroTraza actual;                 // Cuadro en curso, todavía sin publicar
+    Uint32 ticks_inicio;                // Ticks de la simulación al empezar el cuadro
+    Uint64 nodos_inicio;                // Nodos expandidos al empezar el cuadro
+    Uint64 llamadas_inicio;             // Llamadas de dibujo al empezar el cuadro
+} AnilloTrazas;
+
+static AnilloTrazas anillo_trazas;
+
+// Microsegundos entre dos lecturas del contador de rendimiento
+static inline Uint32 traza_microsegundos(Uint64 desde, Uint64 hasta) {
+    return (Uint32)((hasta - desde) * 1000000 / SDL_GetPerformanceFrequency());
+}
+
+// Empieza un cuadro con los contadores acumulados de ticks, nodos y llamadas
+static void traza_abrir_cuadro(Uint32 ticks, Uint64 nodos, Uint64 llamadas) {
+    memset(&anillo_trazas.actual, 0, sizeof(anillo_trazas.actual));
+    anillo_trazas.actual.inicio = SDL_GetPerformanceCounter();
+    anillo_trazas.ticks_inicio = ticks;
+    anillo_trazas.nodos_inicio = nodos;
+    anillo_trazas.llamadas_inicio = llamadas;
+}
+
+// Suma a una etapa el tiempo desde "inicio" (una etapa puede ocurrir más de una vez por cuadro)
+static void traza_cerrar_etapa(enum EtapaCuadro etapa, Uint64 inicio) {
+    CuadroTraza* c = &anillo_trazas.actual;
+    if (c->duracion[etapa] == 0) {
+        c->desde[etapa] = traza_microsegundos(c->inicio, inicio);
+    }
+    Uint32 duracion = traza_microsegundos(inicio, SDL_GetPerformanceCounter());
+    c->duracion[etapa] += duracion > 0 ? duracion : 1; // Una etapa que ocurrió nunca queda en 0
+}
+
+// Termina el cuadro en curso y lo publica en el anillo
+static void traza_cerrar_cuadro(Uint32 ticks, Uint64 nodos, Uint64 llamadas) {
+    CuadroTraza* c = &anillo_trazas.actual;
+    c->total = traza_microsegundos(c->inicio, SDL_GetPerformanceCounter());
+    c->ticks = ticks - anillo_trazas.ticks_inicio;
+    c->nodos = (Uint32)(nodos - anillo_trazas.nodos_inicio);
+    c->llamadas = (Uint32)(llamadas - anillo_trazas.llamadas_inicio);
+    int escritos = SDL_AtomicGet(&anillo_trazas.escritos);
+    anillo_trazas.cuadros[escritos & (CAPACIDAD_TRAZA - 1)] = *c;
+    SDL_AtomicAdd(&anillo_trazas.escritos, 1); // Barrera completa: el cuadro queda escrito antes de publicarse
+}
+
+// =================== Función traza_leer ===================
+// Copia el cuadro número "indice" (contando desde el inicio) sin detener al
+// hilo que escribe
+// Retorna: false si ya no está en el anillo o se pisó durante la copia
+static bool traza_leer(int indice, CuadroTraza* copia) {
+    int escritos = SDL_AtomicGet(&anillo_trazas.escritos);
+    if (indice >= escritos || escritos - indice > CAPACIDAD_TRAZA) {
+        return false;
+    }
+    *copia = anillo_trazas.cuadros[indice & (CAPACIDAD_TRAZA - 1)];
+    // Si mientras se copiaba se escribió en esa posición, la copia no sirve
+    return SDL_AtomicGet(&anillo_trazas.escritos) - indice <= CAPACIDAD_TRAZA;
+}
+
+// Actualiza el overlay con el último cuadro publicado
+static void traza_actualizar_overlay(void) {
+    CuadroTraza c;
+    if (mostrar_traza && traza_leer(SDL_AtomicGet(&anillo_trazas.escritos) - 1, &c)) {
+        snprintf(texto_traza, sizeof(texto_traza), "SIM %.2f DIB %.2f PRES %.2f MS  NODOS %u  LLAMADAS %u",
+                 c.duracion[ETAPA_SIMULACION] / 1000.0, c.duracion[ETAPA_DIBUJO] / 1000.0,
+                 c.duracion[ETAPA_PRESENTAR] / 1000.0, (unsigned)c.nodos, (unsigned)c.llamadas);
+    }
+}
+
+// ================= Función traza_exportar =================
+// Escribe los cuadros que quedan en el anillo en el formato de trazas de
+// Chrome: un evento "X" por etapa y un evento "C" (contadores) por cuadro
+// Retorna: 0 si se pudo escribir o -1 en caso de error
+int traza_exportar(const char* ruta) {
+    FILE* archivo = fopen(ruta, "w");
+    if (archivo == NULL) {
+        printf("No se pudo crear la traza %s\n", ruta);
+        return -1;
+    }
+    int escritos = SDL_AtomicGet(&anillo_trazas.escritos);
+    int primero = escritos > CAPACIDAD_TRAZA ? escritos - CAPACIDAD_TRAZA : 0;
+    Uint64 origen = 0;
+    bool separar = false;
+    fprintf(archivo, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (int i = primero; i < escritos; i++) {
+        CuadroTraza c;
+        if (!traza_leer(i, &c)) {
+            continue;
+        }
+        if (origen == 0) {
+            origen = c.inicio;
+        }
+        Uint64 ts = (c.inicio - origen) * 1000000 / SDL_GetPerformanceFrequency();
+        fprintf(archivo, "%s{\"name\": \"cuadro\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %llu, \"dur\": %u}",
+                separar ? ",\n" : "", (unsigned long long)ts, (unsigned)c.total);
+        separar = true;
+        for (int e = 0; e < CANT_ETAPAS; e++) {
+            if (c.duracion[e] > 0) {
+                fprintf(archivo, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %llu, \"dur\": %u}",
+                        nombres_etapas[e], (unsigned long long)(ts + c.desde[e]), (unsigned)c.duracion[e]);
+            }
+        }
+        fprintf(archivo, ",\n{\"name\": \"contadores\", \"ph\": \"C\", \"pid\": 1, \"ts\": %llu, "
+                         "\"args\": {\"ticks\": %u, \"nodos_a_estrella\": %u, \"llamadas_dibujo\": %u}}",
+                (unsigned long long)ts, (unsigned)c.ticks, (unsigned)c.nodos, (unsigned)c.llamadas);
+    }
+    fprintf(archivo, "\n]}\n");
+    printf("Traza: %d cuadros en %s\n", escritos - primero, ruta);
+    return fclose(archivo) == 0 ? 0 : -1;
+}
+
+// Macros de instrumentación: TRAZA_ETAPA(etapa) { ... } mide el bloque que la sigue
+#define TRAZA_CUADRO_INICIO(ticks, nodos, llamadas) traza_abrir_cuadro(ticks, nodos, llamadas)
+#define TRAZA_CUADRO_FIN(ticks, nodos, llamadas) (traza_cerrar_cuadro(ticks, nodos, llamadas), traza_actualizar_overlay())
+#define TRAZA_ETAPA(etapa) \
+    for (Uint64 traza_inicio_ = SDL_GetPerformanceCounter(), traza_una_vez_ = 1; traza_una_vez_; \
+         traza_una_vez_ = 0, traza_cerrar_etapa(etapa, traza_inicio_))
+
+#else
+
+#define TRAZA_CUADRO_INICIO(ticks, nodos, llamadas) ((void)0)
+#define TRAZA_CUADRO_FIN(ticks, nodos, llamadas) ((void)0)
+#define TRAZA_ETAPA(etapa)
+
+#endif
+
+
+// =================== Función distancia_manhattan ===================
+// Calcula la distancia de Manhattan (heurística) entre dos posiciones
+// Parámetros:
+//   a, b: Dos posiciones del mapa
+// Retorna: La distancia de Manhattan entre las posiciones
+int distancia_manhattan(Posicion a, Posicion b) {
+    // Distancia de Manhattan: |x1 - x2| + |y1 - y2|
+    return abs(a.x - b.x) + abs(a.y - b.y);
+}
+
+
+// ========================== Arena de Memoria ==========================
+// Bloque de memoria por nivel del que salen los puntos que quedan, la capa de
+// ocupación, los fantasmas y todas las rejillas de la búsqueda de caminos;
+// las rejillas del mapa no, porque se comparten, de solo lectura, con la
+// plantilla. Se reserva una sola vez, del tamaño exacto que pide el nivel, y
+// se libera entero al terminarlo: el consumo de memoria queda fijado al
+// empezar el nivel y no hay reservas durante el juego.
+
+// Alineación de cada bloque entregado (una línea de caché)
+#define ALINEACION_ARENA 64
+
+typedef struct {
+    void* bloque;               // Memoria reservada con malloc
+    Uint8* memoria;             // Inicio alineado del bloque
+    size_t tamano;              // Bytes disponibles desde "memoria"
+    size_t usado;               // Bytes ya entregados
+} Arena;
+
+// Bytes que ocupa dentro de la arena un bloque de "tamano" bytes, con su alineación
+static inline size_t arena_medida(size_t tamano) {
+    return (tamano + ALINEACION_ARENA - 1) / ALINEACION_ARENA * ALINEACION_ARENA;
+}
+
+// =================== Función arena_iniciar ===================
+// Reserva una arena con lugar para "tamano" bytes (sumando las medidas de arena_medida)
+// Retorna: 0 si se pudo reservar o -1 si falta memoria
+int arena_iniciar(Arena* arena, size_t tamano) {
+    memset(arena, 0, sizeof(*arena));
+    arena->bloque = malloc(tamano + ALINEACION_ARENA);
+    if (arena->bloque == NULL) {
+        return -1;
+    }
+    SDL_AtomicIncRef(&asignaciones);
+    arena->memoria = (Uint8*)(((uintptr_t)arena->bloque + ALINEACION_ARENA - 1) & ~(uintptr_t)(ALINEACION_ARENA - 1));
+    arena->tamano = tamano;
+    return 0;
+}
+
+// =================== Función arena_reservar ===================
+// Entrega un bloque alineado de "tamano" bytes de la arena
+// Retorna: el bloque o NULL si la arena no tiene lugar
+void* arena_reservar(Arena* arena, size_t tamano) {
+    size_t medida = arena_medida(tamano);
+    if (medida > arena->tamano - arena->usado) {
+        return NULL;
+    }
+    void* bloque = arena->memoria + arena->usado;
+    arena->usado += medida;
+    return bloque;
+}
+
+// Libera toda la memoria de la arena
+void arena_liberar(Arena* arena) {
+    free(arena->bloque);
+    memset(arena, 0, sizeof(*arena));
+}
+
+
+// ========================== Capa de Ocupación ==========================
+// Rejilla del nivel con el mismo paso que el mapa, que dice con una sola
+// lectura qué bloquea cada celda: una pared (también las de relleno) o
+// cuántos fantasmas hay en ella. Se arma al empezar el nivel y se actualiza
+// en cada paso de un fantasma, así validar un movimiento, detectar que un
+// fantasma alcanzó a Pac-Man o saber si una celda está ocupada no depende de
+// la cantidad de personajes en juego. Pac-Man no bloquea a nadie, por eso no
+// figura en la capa.
+#define OCUPACION_PARED     0x8000  // La celda es una pared
+#define OCUPACION_FANTASMAS 0x7FFF  // Cantidad de fantasmas en la celda
+
+// Bytes de arena que necesita la capa para un mapa de "celdas" celdas
+size_t ocupacion_memoria(int celdas) {
+    return arena_medida((size_t)celdas * sizeof(Uint16));
+}
+
+// =================== Función ocupacion_iniciar ===================
+// Toma la capa de la arena y marca las paredes del mapa (sin personajes)
+// Retorna: la capa o NULL si la arena no tenía lugar
+Uint16* ocupacion_iniciar(Arena* arena, const Mapa* mapa) {
+    int celdas = mapa_celdas(mapa);
+    Uint16* capa = arena_reservar(arena, (size_t)celdas * sizeof(Uint16));
+    if (capa == NULL) {
+        printf("Error: no hay memoria para la capa de ocupación\n");
+        return NULL;
+    }
+    for (int i = 0; i < celdas; i++) {
+        capa[i] = mapa_es_pared(mapa, i) ? OCUPACION_PARED : 0;
+    }
+    return capa;
+}
+
+// Mueve un fantasma de una celda a otra
+static inline void ocupacion_mover(Uint16* capa, int desde, int hasta) {
+    capa[desde]--;
+    capa[hasta]++;
+}
+
+// Indica si hay al menos un fantasma en la celda
+static inline bool ocupacion_hay_fantasma(const Uint16* capa, int celda) {
+    return (capa[celda] & OCUPACION_FANTASMAS) != 0;
+}
+
+// ====================== Función es_posicion_valida ======================
+// Verifica si una posición es válida para moverse (no hay obstáculos ni fantasmas)
+// Parámetros:
+//   mapa: Vista de solo lectura del mapa
+//   pos: Posición a verificar
+//   ocupacion: Capa de ocupación del nivel
+int es_posicion_valida(const VistaMapa* mapa, Posicion pos, const Uint16* ocupacion) {
+    // Verifica que la posición esté dentro de los límites del mapa y que la capa no tenga una pared ni fantasmas
+    return pos.x >= 0 && pos.x < mapa->columnas && pos.y >= 0 && pos.y < mapa->filas &&
+           (ocupacion[pos.y * mapa->paso + pos.x] & (OCUPACION_PARED | OCUPACION_FANTASMAS)) == 0;
+}
+
+
+// ====================== Motor de búsqueda A* ======================
+// Estado reutilizable entre llamadas a a_estrella. La lista abierta es un
+// montículo binario indexado (permite extraer el mínimo y disminuir la clave
+// en O(log n)) y las listas abierta/cerrada se marcan con un número de
+// generación, de modo que no hace falta limpiar las rejillas en cada búsqueda.
+// Las rejillas salen de la arena del nivel.
+typedef struct {
+    int* monticulo;              // Celdas de la lista abierta ordenadas como montículo por f
+    int* indice_monticulo;       // Posición de cada celda dentro del montículo
+    int* g;                      // Costo desde el inicio hasta cada celda
+    int* f;                      // Costo total estimado (g + h) de cada celda
+    int* padre;                  // Celda desde la que se llegó a cada celda
+    unsigned int* estado;        // Sello de generación: 2*gen = abierta, 2*gen+1 = cerrada
+    unsigned int generacion;     // Generación de la búsqueda actual
+    int cantidad;                // Cantidad de celdas en el montículo
+    int capacidad;               // Cantidad de celdas de las rejillas
+    int raiz;                    // Celda desde la que crece el árbol de búsqueda (-1 si no hay árbol)
+    int objetivo;                // Objetivo de la última búsqueda (al que apunta la heurística de la lista abierta)
+    Uint64 expandidos;           // Nodos extraídos de la lista abierta en todas las búsquedas
+} MotorAEstrella;
+
+// Bytes de arena que necesita el motor para un mapa de "celdas" celdas
+size_t motor_memoria(int celdas) {
+    return 6 * arena_medida((size_t)celdas * sizeof(int));
+}
+
+// =================== Función motor_iniciar ===================
+// Toma de la arena las rejillas del motor para un mapa de "celdas" celdas
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int motor_iniciar(MotorAEstrella* motor, Arena* arena, int celdas) {
+    memset(motor, 0, sizeof(*motor));
+    size_t tamano = (size_t)celdas * sizeof(int);
+    motor->monticulo = arena_reservar(arena, tamano);
+    motor->indice_monticulo = arena_reservar(arena, tamano);
+    motor->g = arena_reservar(arena, tamano);
+    motor->f = arena_reservar(arena, tamano);
+    motor->padre = arena_reservar(arena, tamano);
+    motor->estado = arena_reservar(arena, tamano);
+    if (!motor->monticulo || !motor->indice_monticulo || !motor->g ||
+        !motor->f || !motor->padre || !motor->estado) {
+        printf("Error: no hay memoria para el motor A*\n");
+        return -1;
+    }
+    memset(motor->estado, 0, tamano);
+    motor->capacidad = celdas;
+    motor->raiz = -1;
+    return 0;
+}
+
+// =================== Función motor_preparar ===================
+// Comienza una nueva generación de búsqueda
+void motor_preparar(MotorAEstrella* motor) {
+    // Avanza la generación; si el contador se desborda, limpia los sellos una única vez
+    motor->generacion++;
+    if (motor->generacion >= 0x7FFFFFFFu) {
+        for (int i = 0; i < motor->capacidad; i++) {
+            motor->estado[i] = 0;
+        }
+        motor->generacion = 1;
+    }
+    motor->cantidad = 0;
+}
+
+// Compara dos celdas del montículo: menor f primero y, a igual f, mayor g
+// (se prefiere el nodo más profundo, lo que reduce las expansiones en empates)
+static int motor_menor(const MotorAEstrella* motor, int a, int b) {
+    return motor->f[a] < motor->f[b] || (motor->f[a] == motor->f[b] && motor->g[a] > motor->g[b]);
+}
+
+// Sube la celda ubicada en la posición "i" del montículo hasta su lugar
+static void motor_subir(MotorAEstrella* motor, int i) {
+    int celda = motor->monticulo[i];
+    while (i > 0) {
+        int padre = (i - 1) / 2;
+        if (!motor_menor(motor, celda, motor->monticulo[padre])) {
+            break;
+        }
+        motor->monticulo[i] = motor->monticulo[padre];
+        motor->indice_monticulo[motor->monticulo[i]] = i;
+        i = padre;
+    }
+    motor->monticulo[i] = celda;
+    motor->indice_monticulo[celda] = i;
+}
+
+// Baja la celda ubicada en la posición "i" del montículo hasta su lugar
+static void motor_bajar(MotorAEstrella* motor, int i) {
+    int celda = motor->monticulo[i];
+    for (;;) {
+        int hijo = 2 * i + 1;
+        if (hijo >= motor->cantidad) {
+            break;
+        }
+        if (hijo + 1 < motor->cantidad && motor_menor(motor, motor->monticulo[hijo + 1], motor->monticulo[hijo])) {
+            hijo++;
+        }
+        if (!motor_menor(motor, motor->monticulo[hijo], celda)) {
+            break;
+        }
+        motor->monticulo[i] = motor->monticulo[hijo];
+        motor->indice_monticulo[motor->monticulo[i]] = i;
+        i = hijo;
+    }
+    motor->monticulo[i] = celda;
+    motor->indice_monticulo[celda] = i;
+}
+
+// Inserta una celda en la lista abierta o, si ya estaba, disminuye su clave
+static void motor_abrir(MotorAEstrella* motor, int celda) {
+    if (motor->estado[celda] == 2 * motor->generacion) {
+        // Ya estaba en la lista abierta: su f solo pudo disminuir, así que sube
+        motor_subir(motor, motor->indice_monticulo[celda]);
+    } else {
+        motor->estado[celda] = 2 * motor->generacion;
+        motor->monticulo[motor->cantidad] = celda;
+        motor_subir(motor, motor->cantidad++);
+    }
+}
+
+// Extrae la celda de menor f de la lista abierta y la marca como cerrada
+static int motor_extraer(MotorAEstrella* motor) {
+    int celda = motor->monticulo[0];
+    motor->monticulo[0] = motor->monticulo[--motor->cantidad];
+    if (motor->cantidad > 0) {
+        motor_bajar(motor, 0);
+    }
+    motor->estado[celda] = 2 * motor->generacion + 1;
+    return celda;
+}
+
+
+// Recalcula f con la heurística hacia "objetivo" para toda la lista abierta y
+// rearma el montículo (en O(n), bajando desde la mitad)
+static void motor_reordenar(MotorAEstrella* motor, int paso, Posicion objetivo) {
+    for (int i = 0; i < motor->cantidad; i++) {
+        int celda = motor->monticulo[i];
+        Posicion posicion = {celda % paso, celda / paso};
+        motor->f[celda] = motor->g[celda] + distancia_manhattan(posicion, objetivo);
+        motor->indice_monticulo[celda] = i;
+    }
+    for (int i = motor->cantidad / 2 - 1; i >= 0; i--) {
+        motor_bajar(motor, i);
+    }
+}
+
+// ================= Función motor_reenraizar =================
+// Conserva del árbol de búsqueda anterior solo el subárbol que cuelga de
+// "raiz" (una celda cerrada del árbol, por ejemplo la nueva posición del
+// fantasma) y arma la lista abierta con su frontera. Las distancias del
+// subárbol siguen siendo exactas desde la nueva raíz: basta restarles la
+// distancia de la raíz. El costo depende del tamaño del subárbol, no del mapa.
+static void motor_reenraizar(MotorAEstrella* motor, const VistaMapa* mapa, int raiz, const int desplazamiento[4]) {
+    unsigned int cerrada_anterior = 2 * motor->generacion + 1;
+    int base = motor->g[raiz];
+    motor_preparar(motor);
+    unsigned int abierta = 2 * motor->generacion, cerrada = 2 * motor->generacion + 1;
+
+    // Subárbol de la raíz, en orden de distancia: se recorre bajando por los
+    // hijos (vecinos cerrados cuyo padre es la celda actual)
+    int* lista = motor->monticulo;
+    int cantidad = 0;
+    lista[cantidad++] = raiz;
+    motor->estado[raiz] = cerrada;
+    motor->g[raiz] = 0;
+    motor->padre[raiz] = raiz;
+    for (int i = 0; i < cantidad; i++) {
+        int celda = lista[i];
+        unsigned int mascara = mapa->vecinos[celda];
+        for (int d = 0; d < 4; d++) {
+            int vecino = celda + desplazamiento[d];
+            if ((mascara & (1u << d)) && motor->estado[vecino] == cerrada_anterior && motor->padre[vecino] == celda) {
+                motor->estado[vecino] = cerrada;
+                motor->g[vecino] -= base;
+                lista[cantidad++] = vecino;
+            }
+        }
+    }
+
+    // Frontera: vecinos del subárbol que no son parte de él; se guardan desde el
+    // final de la lista y los toma primero el vecino más cercano a la raíz
+    int cant_frontera = 0;
+    for (int i = 0; i < cantidad; i++) {
+        int celda = lista[i];
+        unsigned int mascara = mapa->vecinos[celda];
+        for (int d = 0; d < 4; d++) {
+            int vecino = celda + desplazamiento[d];
+            if ((mascara & (1u << d)) && motor->estado[vecino] != cerrada && motor->estado[vecino] != abierta) {
+                motor->estado[vecino] = abierta;
+                motor->g[vecino] = motor->g[celda] + 1;
+                motor->padre[vecino] = celda;
+                lista[motor->capacidad - 1 - cant_frontera++] = vecino;
+            }
+        }
+    }
+
+    // La frontera pasa a ser la lista abierta (el orden se arma al conocer el objetivo)
+    for (int i = 0; i < cant_frontera; i++) {
+        lista[i] = lista[motor->capacidad - 1 - i];
+    }
+    motor->cantidad = cant_frontera;
+    motor->raiz = raiz;
+}
+
+
+// ================= Algoritmo A* =================
+// Función para encontrar el camino más corto entre un fantasma y Pac-Man.
+// La búsqueda es incremental: el motor conserva el árbol de la búsqueda
+// anterior (celdas cerradas con su distancia exacta desde la raíz, y la
+// lista abierta) y lo repara en lugar de empezar de cero:
+//   - si el fantasma avanzó por el árbol, se conserva el subárbol que cuelga
+//     de su nueva celda (motor_reenraizar);
+//   - si Pac-Man se movió, se reordena la lista abierta con la heurística
+//     hacia su nueva celda y la búsqueda sigue desde donde quedó; si la
+//     nueva celda ya estaba cerrada, el camino sale sin expandir nada.
+// Así el costo de cada búsqueda depende de cuánto cambió la situación y no
+// del tamaño del mapa. El camino se lee con a_estrella_camino.
+// Parámetros:
+//   motor: Estado de la búsqueda (uno por fantasma, para poder reutilizarlo)
+//   mapa: Vista de solo lectura del mapa
+//   inicio: Posición del fantasma
+//   objetivo: Posición de Pac-Man
+// Retorna: La cantidad de celdas del camino (contando inicio y objetivo) o -1 si no hay camino
+int a_estrella(MotorAEstrella* motor, const VistaMapa* mapa, Posicion inicio, Posicion objetivo) {
+    if (mapa->filas * mapa->paso > motor->capacidad) {
+        return -1;
+    }
+
+    // Índices lineales de las celdas de inicio y objetivo
+    int celda_inicio = inicio.y * mapa->paso + inicio.x;
+    int celda_objetivo = objetivo.y * mapa->paso + objetivo.x;
+
+    // Diferencia de índice hacia cada vecino, en el orden de "direcciones"
+    const int desplazamiento[4] = {-mapa->paso, mapa->paso, -1, 1};
+
+    // Reutiliza el árbol anterior si el fantasma está en una de sus celdas
+    // cerradas (y queda lugar para otra generación sin limpiar los sellos)
+    bool reutilizable = motor->raiz != -1 && motor->generacion < 0x7FFFFFFEu &&
+                        motor->estado[celda_inicio] == 2 * motor->generacion + 1;
+    if (!reutilizable) {
+        // Búsqueda desde cero: solo el inicio en la lista abierta
+        motor_preparar(motor);
+        motor->g[celda_inicio] = 0;
+        motor->padre[celda_inicio] = celda_inicio;
+        motor->f[celda_inicio] = distancia_manhattan(inicio, objetivo);
+        motor_abrir(motor, celda_inicio);
+        motor->raiz = celda_inicio;
+        motor->objetivo = celda_objetivo;
+    } else if (celda_inicio != motor->raiz) {
+        motor_reenraizar(motor, mapa, celda_inicio, desplazamiento);
+        motor_reordenar(motor, mapa->paso, objetivo);
+        motor->objetivo = celda_objetivo;
+    } else if (celda_objetivo != motor->objetivo) {
+        motor_reordenar(motor, mapa->paso, objetivo);
+        motor->objetivo = celda_objetivo;
+    }
+
+    // Bucle principal del algoritmo A*; termina enseguida si el objetivo ya está cerrado
+    unsigned int cerrada = 2 * motor->generacion + 1;
+    while (motor->estado[celda_objetivo] != cerrada) {
+        if (motor->cantidad == 0) {
+            return -1; // No se encontró un camino
+        }
+
+        // Extrae el nodo con el menor costo total (f) de la lista abierta
+        int celda_actual = motor_extraer(motor);
+        motor->expandidos++;
+        Posicion actual = {celda_actual % mapa->paso, celda_actual / mapa->paso};
+
+        // Explora los vecinos del nodo actual (arriba, abajo, izquierda, derecha); la
+        // tabla de vecinos ya descarta los que caen fuera del mapa o sobre un obstáculo
+        unsigned int mascara = mapa->vecinos[celda_actual];
+        for (int i = 0; i < 4; i++) {
+            if (!(mascara & (1u << i))) {
+                continue;
+            }
+            Posicion vecino = {actual.x + direcciones[i].x, actual.y + direcciones[i].y};
+            int celda_vecino = celda_actual + desplazamiento[i];
+
+            // Descarta los vecinos que ya están en la lista cerrada
+            unsigned int estado = motor->estado[celda_vecino];
+            if (estado == cerrada) {
+                continue;
+            }
+
+            // Agrega el vecino o actualiza su costo si se encontró un camino mejor
+            int g = motor->g[celda_actual] + 1;
+            if (estado != 2 * motor->generacion || g < motor->g[celda_vecino]) {
+                motor->g[celda_vecino] = g;
+                motor->f[celda_vecino] = g + distancia_manhattan(vecino, objetivo);
+                motor->padre[celda_vecino] = celda_actual; // Registra el recorrido
+                motor_abrir(motor, celda_vecino);
+            }
+        }
+    }
+    return motor->g[celda_objetivo] + 1;
+}
+
+// Escribe en "camino" las celdas del camino de la última búsqueda, desde el
+// inicio hasta "celda_objetivo" (cada celda va en la posición de su distancia,
+// así que no hace falta invertir nada)
+static void a_estrella_camino(const MotorAEstrella* motor, int celda_objetivo, int* camino) {
+    for (int celda = celda_objetivo; ; celda = motor->padre[celda]) {
+        camino[motor->g[celda]] = celda;
+        if (celda == motor->raiz) {
+            break;
+        }
+    }
+}
+
+
+// ====================== Caminos de los Fantasmas ======================
+// Camino guardado de un fantasma en modo A*: se calcula una vez y se sigue
+// paso a paso. Cuando Pac-Man pasa a una celda vecina del final del camino,
+// el camino se alarga (o se acorta, si Pac-Man vuelve sobre sus pasos) en
+// lugar de recalcularse, siempre que el camino alargado siga siendo el más
+// corto (lo dice el árbol de la última búsqueda A*); recién después de
+// MAX_EXTENSIONES_CAMINO pasos agregados, o si el fantasma o Pac-Man se salen
+// del camino, se vuelve a buscar el camino más corto.
+#define MAX_EXTENSIONES_CAMINO 8
+
+typedef struct {
+    int* celdas;                // Celdas del camino; celdas[inicio] es la del fantasma y celdas[fin - 1] el objetivo
+    int inicio, fin;            // Parte vigente del camino
+    int capacidad;              // Lugar de "celdas" (una entrada por celda del mapa)
+    int extensiones;            // Pasos agregados al final desde la última búsqueda
+} CaminoFantasma;
+
+// Indica si el camino guardado sigue sirviendo
+static inline bool camino_vigente(const CaminoFantasma* camino) {
+    return camino->fin > camino->inicio;
+}
+
+// ================= Función camino_seguir_objetivo =================
+// Acompaña un paso de Pac-Man: si su nueva celda es vecina del final del
+// camino y está a un paso más que él desde la raíz de la última búsqueda del
+// motor (celdas[0]), la agrega; si Pac-Man volvió atrás, quita la última; si
+// no, descarta el camino para que se recalcule
+void camino_seguir_objetivo(CaminoFantasma* camino, const MotorAEstrella* motor, const VistaMapa* mapa, int celda_pacman) {
+    if (!camino_vigente(camino) || camino->celdas[camino->fin - 1] == celda_pacman) {
+        return;
+    }
+    int ultima = camino->celdas[camino->fin - 1];
+    if (camino->fin - 2 >= camino->inicio && camino->celdas[camino->fin - 2] == celda_pacman) {
+        camino->fin--; // Pac-Man volvió a la celda anterior del camino
+        return;
+    }
+    bool vecina = false;
+    for (int d = 0; d < 4; d++) {
+        int desplazamiento = direcciones[d].y * mapa->paso + direcciones[d].x;
+        vecina |= (mapa->vecinos[ultima] & (1 << d)) && ultima + desplazamiento == celda_pacman;
+    }
+    // celdas[k] está a k pasos de la raíz: la celda nueva debe estar cerrada en el árbol (su g es exacto) a "fin" pasos
+    bool mas_corto = motor->raiz == camino->celdas[0] && motor->estado[celda_pacman] == 2 * motor->generacion + 1 &&
+                     motor->g[celda_pacman] == camino->fin;
+    if (vecina && mas_corto && camino->extensiones < MAX_EXTENSIONES_CAMINO && camino->fin < camino->capacidad) {
+        camino->celdas[camino->fin++] = celda_pacman;
+        camino->extensiones++;
+    } else {
+        camino->inicio = camino->fin = 0; // Se recalcula en la próxima consulta del fantasma
+    }
+}
+
+// ================= Función camino_siguiente_paso =================
+// Devuelve la próxima celda del fantasma según su camino guardado, y lo
+// recalcula con el A* incremental del fantasma solo si dejó de servir
+Posicion camino_siguiente_paso(CaminoFantasma* camino, MotorAEstrella* motor, const VistaMapa* mapa,
+                               Posicion fantasma, Posicion pacman) {
+    int celda_fantasma = fantasma.y * mapa->paso + fantasma.x;
+    int celda_pacman = pacman.y * mapa->paso + pacman.x;
+
+    // Si el fantasma avanzó desde la última consulta, su celda es la siguiente del camino
+    if (camino_vigente(camino) && camino->celdas[camino->inicio] != celda_fantasma &&
+        camino->inicio + 1 < camino->fin && camino->celdas[camino->inicio + 1] == celda_fantasma) {
+        camino->inicio++;
+    }
+
+    // Recalcula si el fantasma no está al principio del camino o el camino no termina en Pac-Man
+    if (!camino_vigente(camino) || camino->celdas[camino->inicio] != celda_fantasma ||
+        camino->celdas[camino->fin - 1] != celda_pacman) {
+        camino->inicio = camino->fin = camino->extensiones = 0;
+        int longitud = a_estrella(motor, mapa, fantasma, pacman);
+        if (longitud == -1) {
+            return fantasma;
+        }
+        a_estrella_camino(motor, celda_pacman, camino->celdas);
+        camino->fin = longitud;
+    }
+
+    if (camino->inicio + 1 >= camino->fin) {
+        return fantasma; // El fantasma ya está sobre Pac-Man
+    }
+    int siguiente = camino->celdas[camino->inicio + 1];
+    return (Posicion){siguiente % mapa->paso, siguiente / mapa->paso};
+}
+
+
+// ======================== Búsqueda Jerárquica ========================
+// Búsqueda HPA* sobre la jerarquía de clusters del mapa (modo IA_JERARQUICA).
+// Un A* abstracto (el mismo motor de a_estrella, sobre los nodos de la
+// jerarquía en lugar de las celdas) une la celda del fantasma con la de
+// Pac-Man a través de las entradas de los clusters, y el resultado queda
+// guardado como una lista de entradas a visitar. Cada paso del fantasma se
+// refina bajando por un BFS local (a lo sumo TAMANO_CLUSTER² celdas) desde la
+// próxima entrada, que se guarda mientras la entrada no cambie. Cuando Pac-Man
+// pasa a un cluster vecino, el plan no se rehace: se conserva hasta cerca de
+// Pac-Man y solo se busca de nuevo el final (ver jerarquia_reparar). Con 50
+// fantasmas persiguiendo a Pac-Man, un paso cuesta en promedio 0,3 µs en un
+// mapa de 101x51, 6 µs en uno de 1000x1000 y 22 µs en uno de 2000x2000
+// (sin reparar, 0,6, 71 y 276 µs), así que el costo sí crece con el mapa,
+// aunque mucho más despacio que un A* completo. El peor paso sigue siendo
+// rehacer un plan completo (unos 12 ms en 1000x1000), que ocurre al empezar,
+// después de MAX_REPARACIONES_PLAN reparaciones, si Pac-Man salta más de un
+// cluster, si el plan se terminó o si la próxima entrada dejó de ser
+// alcanzable. El BFS local desde Pac-Man lo comparten todos los fantasmas.
+// Todo sale de la arena del nivel.
+
+// Reparaciones seguidas de un plan antes de rehacerlo completo, y distancia
+// en clusters a Pac-Man desde la que se conserva el plan (ver jerarquia_reparar)
+#define MAX_REPARACIONES_PLAN 16
+#define RADIO_REPARACION 2
+
+// BFS local guardado desde una celda (el objetivo de uno o más fantasmas)
+typedef struct {
+    int distancia[TAMANO_CLUSTER * TAMANO_CLUSTER]; // Pasos hasta el origen (indexada con jerarquia_local)
+    int cola[TAMANO_CLUSTER * TAMANO_CLUSTER];      // Cola del BFS
+    int origen;                                     // Celda desde la que se calculó (-1 si no hay)
+    Uint32 version;                                 // Versión de la jerarquía con la que se calculó
+} CampoLocal;
+
+// BFS local desde "origen"; se recalcula solo si cambió el origen o la jerarquía
+static const int* campo_local_actualizar(CampoLocal* campo, const Jerarquia* j, const Uint8* vecinos, int origen) {
+    if (campo->origen != origen || campo->version != j->version) {
+        cluster_bfs(j, vecinos, origen, campo->distancia, campo->cola);
+        campo->origen = origen;
+        campo->version = j->version;
+    }
+    return campo->distancia;
+}
+
+typedef struct {
+    MotorAEstrella motor;                               // A* sobre los nodos abstractos (más el origen y el destino)
+    int* celdas;                                        // Entradas del plan, en el orden en que se visitan
+    int cantidad;                                       // Entradas del plan
+    int siguiente;                                      // Próxima entrada a visitar
+    int cluster_destino;                                // Cluster de Pac-Man cuando se armó el plan (-1 si no hay plan)
+    int reparaciones;                                   // Reparaciones del plan desde que se armó completo
+    CampoLocal entrada;                                 // BFS local desde la próxima entrada del plan
+    int desde_fantasma[TAMANO_CLUSTER * TAMANO_CLUSTER]; // BFS local desde el fantasma (para planear)
+    int desde_pacman[TAMANO_CLUSTER * TAMANO_CLUSTER];   // BFS local desde Pac-Man (para planear)
+    int cola[TAMANO_CLUSTER * TAMANO_CLUSTER];          // Cola de los BFS locales
+} BusquedaJerarquica;
+
+// Nodos abstractos de una jerarquía (sin contar el origen y el destino)
+static inline int jerarquia_nodos(const Jerarquia* j) {
+    return j->clusters_x * j->clusters_y * MAX_NODOS_CLUSTER;
+}
+
+// Bytes de arena que necesita una búsqueda sobre la jerarquía del mapa
+size_t busqueda_jerarquica_memoria(const Mapa* mapa) {
+    int nodos = jerarquia_nodos(mapa->jerarquia);
+    return motor_memoria(nodos + 2) + arena_medida((size_t)nodos * sizeof(int));
+}
+
+// ================ Función busqueda_jerarquica_iniciar ================
+// Toma de la arena el motor y la lista de entradas de una búsqueda
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int busqueda_jerarquica_iniciar(BusquedaJerarquica* busqueda, Arena* arena, const Mapa* mapa) {
+    int nodos = jerarquia_nodos(mapa->jerarquia);
+    busqueda->celdas = arena_reservar(arena, (size_t)nodos * sizeof(int));
+    busqueda->cantidad = busqueda->siguiente = 0;
+    busqueda->cluster_destino = busqueda->entrada.origen = -1;
+    if (busqueda->celdas == NULL) {
+        printf("Error: no hay memoria para la búsqueda jerárquica\n");
+        return -1;
+    }
+    return motor_iniciar(&busqueda->motor, arena, nodos + 2);
+}
+
+// Abre un nodo abstracto con costo "g" desde "padre", si mejora el que tenía
+static inline void jerarquia_relajar(MotorAEstrella* motor, int nodo, int padre, int g, int h) {
+    unsigned int estado = motor->estado[nodo];
+    if (estado == 2 * motor->generacion + 1) {
+        return; // Ya está cerrado
+    }
+    if (estado != 2 * motor->generacion || g < motor->g[nodo]) {
+        motor->g[nodo] = g;
+        motor->f[nodo] = g + h;
+        motor->padre[nodo] = padre;
+        motor_abrir(motor, nodo);
+    }
+}
+
+// Distancia Manhattan entre dos celdas dadas por su índice
+static inline int distancia_celdas(int a, int b, int paso) {
+    return abs(a % paso - b % paso) + abs(a / paso - b / paso);
+}
+
+// ==================== Función jerarquia_buscar ====================
+// A* abstracto desde una celda (la del fantasma, o una entrada del plan al
+// repararlo) hasta la de Pac-Man. El origen se une a los nodos de su cluster
+// y los nodos del cluster de Pac-Man al destino con las distancias de un BFS
+// local; entre nodos se usan las distancias precalculadas de cada cluster y
+// el paso que cruza cada entrada. Deja las entradas a visitar en la lista de
+// la búsqueda a partir de la posición "primera" (las anteriores se conservan)
+// Retorna: 0 si hay camino o -1 si no (o si no entra en la lista)
+static int jerarquia_buscar(BusquedaJerarquica* b, const VistaMapa* mapa, int celda_fantasma, int celda_pacman, int primera) {
+    const Jerarquia* j = mapa->jerarquia;
+    MotorAEstrella* motor = &b->motor;
+    const int desplazamiento[4] = {-mapa->paso, mapa->paso, -1, 1};
+    int origen = jerarquia_nodos(j), destino = origen + 1;
+    int cluster_fantasma = jerarquia_cluster(j, celda_fantasma), cluster_pacman = jerarquia_cluster(j, celda_pacman);
+
+    cluster_bfs(j, mapa->vecinos, celda_fantasma, b->desde_fantasma, b->cola);
+    cluster_bfs(j, mapa->vecinos, celda_pacman, b->desde_pacman, b->cola);
+
+    motor_preparar(motor);
+    motor->raiz = -1; // El árbol abstracto no se reutiliza entre búsquedas
+    jerarquia_relajar(motor, origen, origen, 0, distancia_celdas(celda_fantasma, celda_pacman, mapa->paso));
+    unsigned int cerrada = 2 * motor->generacion + 1;
+    while (motor->estado[destino] != cerrada) {
+        if (motor->cantidad == 0) {
+            return -1; // Pac-Man no es alcanzable
+        }
+        int nodo = motor_extraer(motor);
+        motor->expandidos++;
+        int g = motor->g[nodo];
+        if (nodo == destino) {
+            continue; // Llegó a Pac-Man: el bucle termina
+        }
+
+        if (nodo == origen) {
+            // Nodos del cluster del fantasma (y Pac-Man, si está en el mismo cluster)
+            const Cluster* c = &j->clusters[cluster_fantasma];
+            for (int i = 0; i < c->cantidad; i++) {
+                int d = b->desde_fantasma[jerarquia_local(j, c->celdas[i])];
+                if (d != -1) {
+                    jerarquia_relajar(motor, cluster_fantasma * MAX_NODOS_CLUSTER + i, nodo, d,
+                                      distancia_celdas(c->celdas[i], celda_pacman, mapa->paso));
+                }
+            }
+            if (cluster_fantasma == cluster_pacman && b->desde_fantasma[jerarquia_local(j, celda_pacman)] != -1) {
+                jerarquia_relajar(motor, destino, nodo, b->desde_fantasma[jerarquia_local(j, celda_pacman)], 0);
+            }
+            continue;
+        }
+
+        int cluster = nodo / MAX_NODOS_CLUSTER, i = nodo % MAX_NODOS_CLUSTER;
+        const Cluster* c = &j->clusters[cluster];
+
+        // Dentro del cluster: distancias precalculadas entre sus nodos
+        for (int k = 0; k < c->cantidad; k++) {
+            if (k != i && c->distancias[i][k] != SIN_CAMINO_CLUSTER) {
+                jerarquia_relajar(motor, cluster * MAX_NODOS_CLUSTER + k, nodo, g + c->distancias[i][k],
+                                  distancia_celdas(c->celdas[k], celda_pacman, mapa->paso));
+            }
+        }
+
+        // Cruzando la entrada: la celda de enfrente es un nodo del cluster vecino
+        int enfrente = c->celdas[i] + desplazamiento[c->lados[i]];
+        int cluster_vecino = jerarquia_cluster(j, enfrente);
+        const Cluster* vecino = &j->clusters[cluster_vecino];
+        for (int k = 0; k < vecino->cantidad; k++) {
+            if (vecino->celdas[k] == enfrente) {
+                jerarquia_relajar(motor, cluster_vecino * MAX_NODOS_CLUSTER + k, nodo, g + 1,
+                                  distancia_celdas(enfrente, celda_pacman, mapa->paso));
+                break;
+            }
+        }
+
+        // Hasta Pac-Man, si el nodo está en su cluster
+        if (cluster == cluster_pacman && b->desde_pacman[jerarquia_local(j, c->celdas[i])] != -1) {
+            jerarquia_relajar(motor, destino, nodo, g + b->desde_pacman[jerarquia_local(j, c->celdas[i])], 0);
+        }
+    }
+
+    // Entradas del camino, sin el origen ni el destino: se cuentan y se copian desde el final
+    int cantidad = 0;
+    for (int nodo = motor->padre[destino]; nodo != origen; nodo = motor->padre[nodo]) {
+        cantidad++;
+    }
+    if (primera + cantidad > jerarquia_nodos(j)) {
+        return -1;
+    }
+    int k = primera + cantidad;
+    for (int nodo = motor->padre[destino]; nodo != origen; nodo = motor->padre[nodo]) {
+        b->celdas[--k] = j->clusters[nodo / MAX_NODOS_CLUSTER].celdas[nodo % MAX_NODOS_CLUSTER];
+    }
+    b->cantidad = primera + cantidad;
+    return 0;
+}
+
+// ==================== Función jerarquia_planear ====================
+// Arma un plan nuevo desde la celda del fantasma hasta la de Pac-Man
+// Retorna: 0 si hay camino o -1 si no
+static int jerarquia_planear(BusquedaJerarquica* b, const VistaMapa* mapa, int celda_fantasma, int celda_pacman) {
+    b->cantidad = b->siguiente = b->reparaciones = 0;
+    b->cluster_destino = jerarquia_cluster(mapa->jerarquia, celda_pacman);
+    return jerarquia_buscar(b, mapa, celda_fantasma, celda_pacman, 0);
+}
+
+// ==================== Función jerarquia_reparar ====================
+// Si Pac-Man pasó del cluster del plan a uno vecino, conserva el plan hasta la
+// última entrada que queda a RADIO_REPARACION clusters o más de Pac-Man y solo
+// busca de nuevo desde ahí. Esa búsqueda recorre la zona cercana a Pac-Man y
+// no todo el camino desde el fantasma, así que su costo no crece con la
+// distancia entre ellos. El camino reparado puede ser algo más largo que el
+// mejor, así que después de MAX_REPARACIONES_PLAN reparaciones seguidas el
+// plan se rehace completo.
+// Retorna: 0 si se reparó o -1 si hay que rehacer el plan
+static int jerarquia_reparar(BusquedaJerarquica* b, const VistaMapa* mapa, int celda_pacman) {
+    const Jerarquia* j = mapa->jerarquia;
+    int cluster_pacman = jerarquia_cluster(j, celda_pacman);
+    int px = cluster_pacman % j->clusters_x, py = cluster_pacman / j->clusters_x;
+    if (b->cluster_destino == -1 || b->reparaciones >= MAX_REPARACIONES_PLAN ||
+        abs(b->cluster_destino % j->clusters_x - px) + abs(b->cluster_destino / j->clusters_x - py) != 1) {
+        return -1;
+    }
+
+    // Entrada desde la que se vuelve a buscar (si el fantasma ya está cerca, el plan se rehace)
+    int corte = b->cantidad - 1;
+    for (; corte >= b->siguiente; corte--) {
+        int cluster = jerarquia_cluster(j, b->celdas[corte]);
+        if (SDL_max(abs(cluster % j->clusters_x - px), abs(cluster / j->clusters_x - py)) >= RADIO_REPARACION) {
+            break;
+        }
+    }
+    if (corte < b->siguiente || jerarquia_buscar(b, mapa, b->celdas[corte], celda_pacman, corte + 1) == -1) {
+        return -1;
+    }
+    b->cluster_destino = cluster_pacman;
+    b->reparaciones++;
+    return 0;
+}
+
+
+
+// ================ Función jerarquia_siguiente_paso ================
+// Devuelve la próxima celda del fantasma: si Pac-Man está en su cluster y se
+// llega sin salir de él, un paso del BFS local hacia Pac-Man; si no, un paso
+// hacia la próxima entrada del plan (que se repara o se rehace si dejó de servir).
+// "cerca" es el BFS local desde Pac-Man, compartido por todos los fantasmas
+Posicion jerarquia_siguiente_paso(BusquedaJerarquica* b, CampoLocal* cerca, const VistaMapa* mapa, Posicion fantasma, Posicion pacman) {
+    const Jerarquia* j = mapa->jerarquia;
+    int celda_fantasma = fantasma.y * mapa->paso + fantasma.x;
+    int celda_pacman = pacman.y * mapa->paso + pacman.x;
+    if (celda_fantasma == celda_pacman) {
+        return fantasma;
+    }
+    int cluster_fantasma = jerarquia_cluster(j, celda_fantasma), cluster_pacman = jerarquia_cluster(j, celda_pacman);
+    const int desplazamiento[4] = {-mapa->paso, mapa->paso, -1, 1};
+
+    // Mismo cluster: baja por el BFS local desde Pac-Man, si llega sin salir del cluster
+    if (cluster_fantasma == cluster_pacman) {
+        int paso = cluster_bajar(j, mapa->vecinos, campo_local_actualizar(cerca, j, mapa->vecinos, celda_pacman), celda_fantasma);
+        if (paso != -1) {
+            return (Posicion){paso % mapa->paso, paso / mapa->paso};
+        }
+    }
+
+    // Si Pac-Man pasó a un cluster vecino, primero se intenta reparar el plan
+    if (b->cluster_destino != cluster_pacman) {
+        jerarquia_reparar(b, mapa, celda_pacman);
+    }
+
+    for (int intento = 0; intento < 2; intento++) {
+        if (b->cluster_destino == cluster_pacman) {
+            // Saltea las entradas que el fantasma ya alcanzó
+            while (b->siguiente < b->cantidad && b->celdas[b->siguiente] == celda_fantasma) {
+                b->siguiente++;
+            }
+            if (b->siguiente < b->cantidad) {
+                int entrada = b->celdas[b->siguiente];
+                for (int d = 0; d < 4; d++) {
+                    if ((mapa->vecinos[celda_fantasma] & (1u << d)) && celda_fantasma + desplazamiento[d] == entrada) {
+                        return (Posicion){entrada % mapa->paso, entrada / mapa->paso}; // Vecina (o cruzando la entrada)
+                    }
+                }
+                if (jerarquia_cluster(j, entrada) == cluster_fantasma) {
+                    int paso = cluster_bajar(j, mapa->vecinos, campo_local_actualizar(&b->entrada, j, mapa->vecinos, entrada), celda_fantasma);
+                    if (paso != -1) {
+                        return (Posicion){paso % mapa->paso, paso / mapa->paso};
+                    }
+                }
+            }
+        }
+        // El plan no sirve: se rehace una sola vez por consulta
+        if (intento == 1 || jerarquia_planear(b, mapa, celda_fantasma, celda_pacman) == -1) {
+            break;
+        }
+    }
+    b->cluster_destino = -1;
+    return fantasma;
+}
+
+
+// ====================== Campo de distancias ======================
+// Campo de distancias inverso hacia Pac-Man: un único BFS desde la celda de
+// Pac-Man llena una rejilla con la cantidad de pasos hasta él. Cualquier
+// cantidad de fantasmas lee su siguiente paso del campo en O(1), y el campo
+// solo se recalcula cuando Pac-Man cambia de celda. Las rejillas salen de la
+// arena del nivel.
+typedef struct {
+    int* distancia;      // Pasos desde cada celda hasta el origen (-1 si es inalcanzable)
+    int* cola;           // Cola del BFS (índices de celda)
+    int capacidad;       // Cantidad de celdas de las rejillas
+    int filas, columnas; // Dimensiones del mapa para el que se calculó el campo
+    int paso;            // Celdas entre dos filas de la rejilla
+    Posicion origen;     // Celda desde la que se calculó el campo
+    bool valido;         // Indica si el campo corresponde al mapa y origen actuales
+} CampoDistancias;
+
+// Bytes de arena que necesita el campo para un mapa de "celdas" celdas
+size_t campo_memoria(int celdas) {
+    return 2 * arena_medida((size_t)celdas * sizeof(int));
+}
+
+// ================== Función campo_iniciar ==================
+// Toma de la arena las rejillas del campo para un mapa de "celdas" celdas
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int campo_iniciar(CampoDistancias* campo, Arena* arena, int celdas) {
+    memset(campo, 0, sizeof(*campo));
+    campo->distancia = arena_reservar(arena, (size_t)celdas * sizeof(int));
+    campo->cola = arena_reservar(arena, (size_t)celdas * sizeof(int));
+    if (!campo->distancia || !campo->cola) {
+        printf("Error: no hay memoria para el campo de distancias\n");
+        return -1;
+    }
+    campo->capacidad = celdas;
+    return 0;
+}
+
+// ================== Función campo_invalidar ==================
+// Marca el campo como desactualizado (por ejemplo, al cambiar de nivel)
+void campo_invalidar(CampoDistancias* campo) {
+    campo->valido = false;
+}
+
+// ================== Función campo_actualizar ==================
+// Recalcula el campo con un BFS desde "origen", solo si el origen cambió de
+// celda o el campo fue invalidado
+// Parámetros:
+//   campo: Campo a actualizar
+//   mapa: Vista del mapa sobre el que se calcula el campo
+//   origen: Celda de Pac-Man
+// Retorna: 0 si el campo quedó actualizado o -1 si el mapa no entra en las rejillas
+int campo_actualizar(CampoDistancias* campo, const VistaMapa* mapa, Posicion origen) {
+    // Si Pac-Man no cambió de celda, el campo sigue siendo válido
+    if (campo->valido && campo->origen.x == origen.x && campo->origen.y == origen.y) {
+        return 0;
+    }
+
+    int celdas = mapa->filas * mapa->paso;
+    if (celdas > campo->capacidad) {
+        campo->valido = false;
+        return -1;
+    }
+    campo->filas = mapa->filas;
+    campo->columnas = mapa->columnas;
+    campo->paso = mapa->paso;
+
+    // Copias locales: evitan releer la vista y los arreglos del campo en cada iteración
+    const VistaMapa vista = *mapa;
+    int* distancia = campo->distancia;
+    int* cola = campo->cola;
+    const int desplazamiento[4] = {-vista.paso, vista.paso, -1, 1};
+
+    // Marca todas las celdas como inalcanzables
+    for (int i = 0; i < celdas; i++) {
+        distancia[i] = -1;
+    }
+
+    // BFS desde el origen: cada celda recibe la distancia de su predecesor más uno
+    // La tabla de vecinos indica a qué celdas se puede pasar, sin mirar bordes ni paredes
+    int inicio = 0, fin = 0;
+    int celda_origen = origen.y * vista.paso + origen.x;
+    distancia[celda_origen] = 0;
+    cola[fin++] = celda_origen;
+    while (inicio < fin) {
+        int actual = cola[inicio++];
+        int siguiente = distancia[actual] + 1;
+        unsigned int mascara = vista.vecinos[actual];
+        for (int i = 0; i < 4; i++) {
+            if (!(mascara & (1u << i))) {
+                continue;
+            }
+            int celda_vecino = actual + desplazamiento[i];
+            if (distancia[celda_vecino] == -1) {
+                distancia[celda_vecino] = siguiente;
+                cola[fin++] = celda_vecino;
+            }
+        }
+    }
+
+    campo->origen = origen;
+    campo->valido = true;
+    return 0;
+}
+
+// ================ Función campo_siguiente_paso ================
+// Devuelve la celda vecina de "desde" que se acerca un paso al origen del campo
+// Si "desde" ya es el origen o no puede alcanzarlo, devuelve "desde"
+Posicion campo_siguiente_paso(const CampoDistancias* campo, Posicion desde) {
+    int d = campo->distancia[desde.y * campo->paso + desde.x];
+    if (d <= 0) {
+        return desde;
+    }
+
+    // Busca el primer vecino cuya distancia sea exactamente un paso menor
+    for (int i = 0; i < 4; i++) {
+        Posicion vecino = {desde.x + direcciones[i].x, desde.y + direcciones[i].y};
+        if (vecino.x >= 0 && vecino.x < campo->columnas &&
+            vecino.y >= 0 && vecino.y < campo->filas &&
+            campo->distancia[vecino.y * campo->paso + vecino.x] == d - 1) {
+            return vecino;
+        }
+    }
+    return desde;
+}
+
+
+// ========================== IA de los Fantasmas ==========================
+// Estado de la IA de los fantasmas de una partida. Cada partida tiene el suyo,
+// así varias partidas pueden simularse a la vez en distintos hilos.
+typedef struct {
+    enum ModoIA modo;           // Estrategia con la que los fantasmas persiguen a Pac-Man
+    int cant_fantasmas;         // Fantasmas que persiguen a Pac-Man
+    MotorAEstrella* motores;    // Búsqueda A* incremental de cada fantasma (modo IA_A_ESTRELLA)
+    CaminoFantasma* caminos;    // Camino guardado de cada fantasma (modo IA_A_ESTRELLA)
+    CampoDistancias campo;      // Campo de distancias hacia Pac-Man (modo IA_CAMPO_DISTANCIAS)
+    BusquedaJerarquica* jerarquicas; // Búsqueda y plan de cada fantasma (modo IA_JERARQUICA)
+    CampoLocal* cerca;          // BFS local desde Pac-Man, compartido por los fantasmas (modo IA_JERARQUICA)
+} IAFantasmas;
+
+// Modo con el que se juega realmente el mapa: si no tiene tabla de saltos o
+// jerarquía (no se precalcularon, no entraban en memoria o la tabla quedó
+// obsoleta), esos modos buscan con A*
+enum ModoIA ia_modo_efectivo(enum ModoIA modo, const Mapa* mapa) {
+    if ((modo == IA_TABLA_SALTOS && (mapa->saltos == NULL || mapa->saltos->obsoleta)) ||
+        (modo == IA_JERARQUICA && mapa->jerarquia == NULL)) {
+        return IA_A_ESTRELLA;
+    }
+    return modo;
+}
+
+// Bytes de arena que necesita la IA con el modo dado para el mapa
+size_t ia_memoria(enum ModoIA modo, const Mapa* mapa, int cant_fantasmas) {
+    int celdas = mapa_celdas(mapa);
+    if (modo == IA_JERARQUICA) {
+        return arena_medida(sizeof(CampoLocal)) + arena_medida(cant_fantasmas * sizeof(BusquedaJerarquica)) +
+               cant_fantasmas * busqueda_jerarquica_memoria(mapa);
+    }
+    if (modo == IA_A_ESTRELLA) {
+        return arena_medida(cant_fantasmas * sizeof(MotorAEstrella)) + arena_medida(cant_fantasmas * sizeof(CaminoFantasma)) +
+               cant_fantasmas * (motor_memoria(celdas) + arena_medida((size_t)celdas * sizeof(int)));
+    }
+    // La tabla es del mapa y la comparten todas las partidas; el campo queda por
+    // si el mapa cambia durante la partida y la tabla pasa a estar obsoleta
+    return campo_memoria(celdas);
+}
+
+// ==================== Función ia_iniciar ====================
+// Prepara la IA con el modo dado para "cant_fantasmas" fantasmas: solo el
+// buscador de ese modo toma sus rejillas de la arena
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int ia_iniciar(IAFantasmas* ia, enum ModoIA modo, Arena* arena, const Mapa* mapa, int cant_fantasmas) {
+    memset(ia, 0, sizeof(*ia));
+    ia->modo = modo;
+    ia->cant_fantasmas = cant_fantasmas;
+    int celdas = mapa_celdas(mapa);
+    if (modo == IA_JERARQUICA) {
+        ia->cerca = arena_reservar(arena, sizeof(CampoLocal));
+        ia->jerarquicas = arena_reservar(arena, cant_fantasmas * sizeof(BusquedaJerarquica));
+        if (ia->cerca == NULL || ia->jerarquicas == NULL) {
+            printf("Error: no hay memoria para la búsqueda jerárquica\n");
+            return -1;
+        }
+        ia->cerca->origen = -1;
+        for (int i = 0; i < cant_fantasmas; i++) {
+            if (busqueda_jerarquica_iniciar(&ia->jerarquicas[i], arena, mapa) == -1) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (modo != IA_A_ESTRELLA) {
+        return campo_iniciar(&ia->campo, arena, celdas);
+    }
+    ia->motores = arena_reservar(arena, cant_fantasmas * sizeof(MotorAEstrella));
+    ia->caminos = arena_reservar(arena, cant_fantasmas * sizeof(CaminoFantasma));
+    if (ia->motores == NULL || ia->caminos == NULL) {
+        printf("Error: no hay memoria para los caminos de los fantasmas\n");
+        return -1;
+    }
+    memset(ia->caminos, 0, cant_fantasmas * sizeof(CaminoFantasma));
+    for (int i = 0; i < cant_fantasmas; i++) {
+        ia->caminos[i].celdas = arena_reservar(arena, (size_t)celdas * sizeof(int));
+        ia->caminos[i].capacidad = celdas;
+        if (ia->caminos[i].celdas == NULL) {
+            printf("Error: no hay memoria para los caminos de los fantasmas\n");
+            return -1;
+        }
+        if (motor_iniciar(&ia->motores[i], arena, celdas) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// ================ Función ia_seguir_objetivo ================
+// Avisa a la IA que Pac-Man cambió de celda, para que los caminos guardados
+// de los fantasmas lo acompañen sin recalcularse
+void ia_seguir_objetivo(IAFantasmas* ia, const VistaMapa* mapa, Posicion pacman) {
+    if (ia->modo != IA_A_ESTRELLA) {
+        return; // El campo se recalcula en la próxima consulta, la tabla no cambia y los planes jerárquicos se revisan en cada paso
+    }
+    for (int i = 0; i < ia->cant_fantasmas; i++) {
+        camino_seguir_objetivo(&ia->caminos[i], &ia->motores[i], mapa, pacman.y * mapa->paso + pacman.x);
+    }
+}
+
+// Nodos que expandieron en total las búsquedas A* (de celdas o abstractas) de
+// los fantasmas (0 en los otros modos)
+Uint64 ia_nodos_expandidos(const IAFantasmas* ia) {
+    Uint64 nodos = 0;
+    for (int i = 0; ia->modo == IA_A_ESTRELLA && i < ia->cant_fantasmas; i++) {
+        nodos += ia->motores[i].expandidos;
+    }
+    for (int i = 0; ia->modo == IA_JERARQUICA && i < ia->cant_fantasmas; i++) {
+        nodos += ia->jerarquicas[i].motor.expandidos;
+    }
+    return nodos;
+}
+
+// =============== Función siguiente_paso_fantasma ===============
+// Calcula la próxima celda del fantasma "indice" que persigue a Pac-Man según
+// el modo de IA de la partida (campo de distancias compartido, camino A*
+// guardado por fantasma, tabla de saltos precalculada o plan jerárquico)
+Posicion siguiente_paso_fantasma(IAFantasmas* ia, const VistaMapa* mapa, int indice, Posicion fantasma, Posicion pacman) {
+    if (ia->modo == IA_A_ESTRELLA) {
+        return camino_siguiente_paso(&ia->caminos[indice], &ia->motores[indice], mapa, fantasma, pacman);
+    }
+    if (ia->modo == IA_TABLA_SALTOS && !mapa->saltos->obsoleta) {
+        return saltos_siguiente_paso(mapa->saltos, mapa, fantasma, pacman);
+    }
+    if (ia->modo == IA_JERARQUICA) {
+        return jerarquia_siguiente_paso(&ia->jerarquicas[indice], ia->cerca, mapa, fantasma, pacman);
+    }
+
+    // Campo de distancias (también en modo tabla si la tabla quedó obsoleta): se
+    // recalcula solo si Pac-Man cambió de celda desde la última consulta
+    if (campo_actualizar(&ia->campo, mapa, pacman) == -1) {
+        return fantasma;
+    }
+    return campo_siguiente_paso(&ia->campo, fantasma);
+}
+
+
+// ========================== Núcleo de Simulación ==========================
+// Lógica pura de un nivel (movimiento de Pac-Man, pasos de los fantasmas,
+// puntos comidos, colisiones y fin de nivel), sin SDL, ventana ni audio.
+// La usa tanto el bucle del juego como el modo --headless.
+
+// Eventos que puede producir un tick de simulación (se combinan con |)
+#define EVENTO_PUNTO      0x1  // Pac-Man comió un punto
+#define EVENTO_COMPLETADO 0x2  // Se comieron todos los puntos del nivel
+#define EVENTO_MUERTE     0x4  // Un fantasma alcanzó a Pac-Man
+
+// Parámetros ajustables de una partida (velocidades y retardos en ticks)
+// Las velocidades y los retardos son los de los fantasmas del mapa: el
+// fantasma i usa los del fantasma i % CANT_FANTASMAS
+typedef struct {
+    enum ModoIA modo;                           // Estrategia de IA de los fantasmas
+    int cant_fantasmas;                         // Fantasmas de la partida
+    int velocidad_pacman;                       // Ticks entre dos pasos de Pac-Man
+    int velocidad_fantasmas[CANT_FANTASMAS];    // Ticks entre dos pasos de cada fantasma
+    int salida_fantasmas[CANT_FANTASMAS];       // Ticks que espera cada fantasma antes de salir
+} ParametrosIA;
+
+// Fantasmas de una partida, guardados como estructura de arreglos: un arreglo
+// por campo con un elemento por fantasma, todos tomados de la arena del nivel.
+// Así el recorrido de cada tick lee los contadores seguidos en memoria y la
+// cantidad de fantasmas no está fija. Sus posiciones se reflejan en la capa de
+// ocupación del nivel (varios fantasmas pueden compartir la celda de salida)
+typedef struct {
+    int cantidad;               // Cantidad de fantasmas
+    Posicion* posiciones;       // Posición de cada fantasma
+    int* contadores;            // Ticks desde el último paso de cada fantasma
+    int* velocidades;           // Ticks entre dos pasos de cada fantasma
+    int* salidas;               // Ticks que espera cada fantasma antes de salir
+    int* contadores_salida;     // Ticks transcurridos del retardo de salida de cada fantasma
+} Fantasmas;
+
+// Bytes de arena que necesitan "cantidad" fantasmas
+size_t fantasmas_memoria(int cantidad) {
+    return arena_medida(cantidad * sizeof(Posicion)) + 4 * arena_medida(cantidad * sizeof(int));
+}
+
+// ==================== Función fantasmas_iniciar ====================
+// Toma de la arena los arreglos de los fantasmas y los ubica en las
+// posiciones iniciales del mapa (y en la capa de ocupación), con las
+// velocidades y retardos de "parametros"
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int fantasmas_iniciar(Fantasmas* fantasmas, Arena* arena, const Mapa* mapa, const ParametrosIA* parametros, Uint16* ocupacion) {
+    int cantidad = parametros->cant_fantasmas;
+    fantasmas->cantidad = cantidad;
+    fantasmas->posiciones = arena_reservar(arena, cantidad * sizeof(Posicion));
+    fantasmas->contadores = arena_reservar(arena, cantidad * sizeof(int));
+    fantasmas->velocidades = arena_reservar(arena, cantidad * sizeof(int));
+    fantasmas->salidas = arena_reservar(arena, cantidad * sizeof(int));
+    fantasmas->contadores_salida = arena_reservar(arena, cantidad * sizeof(int));
+    if (!fantasmas->posiciones || !fantasmas->contadores || !fantasmas->velocidades ||
+        !fantasmas->salidas || !fantasmas->contadores_salida) {
+        printf("Error: no hay memoria para los fantasmas\n");
+        return -1;
+    }
+    for (int i = 0; i < cantidad; i++) {
+        Posicion inicio = mapa->inicio_fantasmas[i % CANT_FANTASMAS];
+        fantasmas->posiciones[i] = inicio;
+        fantasmas->contadores[i] = 0;
+        fantasmas->velocidades[i] = parametros->velocidad_fantasmas[i % CANT_FANTASMAS];
+        fantasmas->salidas[i] = parametros->salida_fantasmas[i % CANT_FANTASMAS];
+        fantasmas->contadores_salida[i] = 0;
+        ocupacion[inicio.y * mapa->paso + inicio.x]++;
+    }
+    return 0;
+}
+
+// Mueve el fantasma "i" a otra celda y lo refleja en la capa de ocupación
+static inline void fantasmas_mover(Fantasmas* fantasmas, Uint16* ocupacion, int paso, int i, Posicion destino) {
+    Posicion* origen = &fantasmas->posiciones[i];
+    ocupacion_mover(ocupacion, origen->y * paso + origen->x, destino.y * paso + destino.x);
+    *origen = destino;
+}
+
+// Bytes de arena que necesita el índice de puntos de un mapa de "celdas" celdas
+size_t puntos_memoria(int celdas) {
+    return arena_medida((size_t)(celdas + 63) / 64 * sizeof(Uint64));
+}
+
+// ===================== Función puntos_iniciar =====================
+// Toma de la arena el conjunto de puntos del nivel y lo llena con el índice
+// de puntos del mapa (todos los puntos sin comer)
+// Retorna: 0 si la arena tenía lugar o -1 si no
+int puntos_iniciar(PuntosNivel* puntos, Arena* arena, const Mapa* mapa) {
+    size_t palabras = (size_t)(mapa_celdas(mapa) + 63) / 64;
+    puntos->bits = arena_reservar(arena, palabras * sizeof(Uint64));
+    if (puntos->bits == NULL) {
+        printf("Error: no hay memoria para los puntos del nivel\n");
+        return -1;
+    }
+    memset(puntos->bits, 0, palabras * sizeof(Uint64));
+    for (int k = 0; k < mapa->puntos_totales; k++) {
+        puntos->bits[mapa->puntos[k] >> 6] |= (Uint64)1 << (mapa->puntos[k] & 63);
+    }
+    puntos->totales = puntos->restantes = mapa->puntos_totales;
+    return 0;
+}
+
+// Estado completo de un nivel en curso. No comparte nada mutable con otras
+// partidas: el mapa es de solo lectura y los puntos que quedan, las
+// posiciones y la IA son propios de la partida.
+typedef struct {
+    Mapa mapa;                                  // Mapa del nivel (comparte sus rejillas, de solo lectura, con la plantilla)
+    VistaMapa vista;                            // Vista de solo lectura del mapa
+    int nivel;                                  // Número de nivel
+    ParametrosIA parametros;                    // Velocidades, retardos y modo de IA de la partida
+    Arena arena;                                // Memoria del nivel: puntos, ocupación, fantasmas y rejillas de la IA
+    IAFantasmas ia;                             // Buscadores de caminos de los fantasmas
+    Posicion pacman;                            // Posición de Pac-Man
+    Fantasmas fantasmas;                        // Posiciones, contadores, velocidades y retardos de los fantasmas
+    Uint16* ocupacion;                          // Capa de ocupación: paredes y fantasmas de cada celda
+    PuntosNivel puntos;                         // Puntos que quedan: dan el puntaje y el fin del nivel
+    enum Direccion direccion;                   // Dirección en la que se mueve Pac-Man
+    int contador_pacman;                        // Ticks desde el último paso de Pac-Man
+    Uint32 ticks;                               // Ticks simulados desde el inicio del nivel
+} Simulacion;
+
+// ================== Función parametros_por_defecto ==================
+// Llena los parámetros de un nivel según su dificultad
+void parametros_por_defecto(ParametrosIA* parametros, int nivel) {
+    parametros->modo = modo_ia;
+    parametros->cant_fantasmas = fantasmas_del_nivel(nivel);
+
+    // Configuración de velocidades basadas en la dificultad
+    parametros->velocidad_pacman = VELOCIDAD_PACMAN - (20 * nivel);
+    parametros->velocidad_fantasmas[0] = VELOCIDAD_FANTASMA - (25 * nivel);
+    parametros->velocidad_fantasmas[1] = VELOCIDAD_FANTASMA2 - (25 * nivel);
+    parametros->velocidad_fantasmas[2] = VELOCIDAD_FANTASMA3 - (30 * nivel);
+
+    // El primer fantasma sale de inmediato; los otros esperan su retardo
+    parametros->salida_fantasmas[0] = 0;
+    parametros->salida_fantasmas[1] = SALIDA_FANTASMA2;
+    parametros->salida_fantasmas[2] = SALIDA_FANTASMA3;
+}
+
+// ==================== Función simulacion_iniciar ====================
+// Prepara una simulación para el nivel indicado
+// Parámetros:
+//   sim: Simulación a preparar
+//   plantilla: Mapa ya cargado del nivel (no se modifica; sus rejillas se comparten)
+//   nivel: Número de nivel
+//   parametros: Parámetros de la partida, o NULL para usar los del nivel
+// Retorna: 0 si se pudo preparar o -1 si no hay memoria para el nivel
+int simulacion_iniciar(Simulacion* sim, const Mapa* plantilla, int nivel, const ParametrosIA* parametros) {
+    memset(sim, 0, sizeof(*sim));
+
+    sim->nivel = nivel;
+    if (parametros != NULL) {
+        sim->parametros = *parametros;
+    } else {
+        parametros_por_defecto(&sim->parametros, nivel);
+    }
+
+    // Toda la memoria del nivel sale de una única arena del tamaño justo
+    sim->parametros.modo = ia_modo_efectivo(sim->parametros.modo, plantilla);
+    int celdas = mapa_celdas(plantilla), cant_fantasmas = sim->parametros.cant_fantasmas;
+    if (arena_iniciar(&sim->arena, puntos_memoria(celdas) + ocupacion_memoria(celdas) + fantasmas_memoria(cant_fantasmas) +
+                                   ia_memoria(sim->parametros.modo, plantilla, cant_fantasmas)) == -1) {
+        return -1;
+    }
+
+    // El mapa no cambia durante el nivel: todas sus rejillas se comparten con la
+    // plantilla y lo único propio de la partida son los puntos que quedan
+    sim->mapa = *plantilla;
+    sim->vista = vista_mapa(&sim->mapa);
+    if (puntos_iniciar(&sim->puntos, &sim->arena, plantilla) == -1 ||
+        ia_iniciar(&sim->ia, sim->parametros.modo, &sim->arena, plantilla, cant_fantasmas) == -1) {
+        arena_liberar(&sim->arena);
+        return -1;
+    }
+
+    // Posiciones iniciales de Pac-Man y los fantasmas, indicadas por el mapa
+    sim->pacman = plantilla->inicio_pacman;
+    sim->ocupacion = ocupacion_iniciar(&sim->arena, plantilla);
+    if (sim->ocupacion == NULL ||
+        fantasmas_iniciar(&sim->fantasmas, &sim->arena, plantilla, &sim->parametros, sim->ocupacion) == -1) {
+        arena_liberar(&sim->arena);
+        return -1;
+    }
+    sim->direccion = DERECHA;
+    return 0;
+}
+
+// ==================== Función simulacion_liberar ====================
+// Libera la arena del nivel: los puntos, la ocupación, los fantasmas y las
+// rejillas de los buscadores de caminos
+void simulacion_liberar(Simulacion* sim) {
+    arena_liberar(&sim->arena);
+    sim->puntos.bits = NULL;
+}
+
+// ================ Función simulacion_pacman_se_mueve ================
+// Indica si Pac-Man dará un paso en el próximo tick (sirve para decidir
+// la entrada justo antes de que se aplique)
+bool simulacion_pacman_se_mueve(const Simulacion* sim) {
+    return sim->contador_pacman >= sim->parametros.velocidad_pacman;
+}
+
+// Posiciones de Pac-Man y los fantasmas, para dibujarlos
+Personajes simulacion_personajes(const Simulacion* sim) {
+    return (Personajes){sim->pacman, sim->fantasmas.posiciones, sim->fantasmas.cantidad};
+}
+
+// ====================== Función simulacion_tick ======================
+// Avanza la simulación un tick (PASO_SIMULACION_MS)
+// Retorna: Combinación de EVENTO_* ocurridos durante el tick
+int simulacion_tick(Simulacion* sim) {
+    int eventos = 0;
+    Fantasmas* f = &sim->fantasmas;
+    sim->ticks++;
+
+    // ========================== Movimiento de Pac-Man ==========================
+    if (sim->contador_pacman >= sim->parametros.velocidad_pacman) {
+        Posicion nueva_posicion = {
+            sim->pacman.x + direcciones[sim->direccion].x,
+            sim->pacman.y + direcciones[sim->direccion].y
+        };
+        if (es_posicion_valida(&sim->vista, nueva_posicion, sim->ocupacion)) {
+            if (puntos_comer(&sim->puntos, mapa_indice(&sim->mapa, nueva_posicion.x, nueva_posicion.y))) {
+                eventos |= EVENTO_PUNTO;
+            }
+            sim->pacman = nueva_posicion;
+            ia_seguir_objetivo(&sim->ia, &sim->vista, sim->pacman);
+        }
+        sim->contador_pacman = 0;
+    } else {
+        sim->contador_pacman++;
+    }
+
+    // ========================== Movimiento de Fantasmas ==========================
+    for (int i = 0; i < f->cantidad; i++) {
+        if (f->contadores[i] >= f->velocidades[i] && f->salidas[i] <= f->contadores_salida[i]) {
+            Posicion paso = siguiente_paso_fantasma(&sim->ia, &sim->vista, i, f->posiciones[i], sim->pacman);
+            if (es_posicion_valida(&sim->vista, paso, sim->ocupacion)) {
+                fantasmas_mover(f, sim->ocupacion, sim->mapa.paso, i, paso);
+            }
+            f->contadores[i] = 0;
+        } else if (f->salidas[i] > f->contadores_salida[i]) {
+            f->contadores_salida[i]++;
+        } else {
+            f->contadores[i]++;
+        }
+    }
+
+    // ========================== Verificar Condiciones de Fin de Nivel ==========================
+    if (sim->puntos.restantes == 0) {
+        eventos |= EVENTO_COMPLETADO;
+    }
+
+    // Verificar colisión de Pac-Man con los fantasmas
+    if (ocupacion_hay_fantasma(sim->ocupacion, mapa_indice(&sim->mapa, sim->pacman.x, sim->pacman.y))) {
+        eventos |= EVENTO_MUERTE;
+    }
+    return eventos;
+}
+
+
+// ========================== Entrada Automática ==========================
+// Genera la entrada de Pac-Man sin teclado: sigue un guion de direcciones
+// o elige direcciones al azar. Se usa en el modo --headless.
+typedef struct {
+    const char* guion;      // Direcciones por paso de Pac-Man (A=arriba, B=abajo, I=izquierda, D=derecha) o NULL
+    int posicion_guion;     // Próxima letra del guion a usar
+    Uint32 semilla;         // Estado del generador pseudoaleatorio (xorshift32)
+} EntradaAutomatica;
+
+// Genera el siguiente número pseudoaleatorio (xorshift32: rápido y reproducible)
+Uint32 aleatorio_siguiente(Uint32* estado) {
+    Uint32 x = *estado;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *estado = x;
+    return x;
+}
+
+// ================= Función entrada_siguiente_direccion =================
+// Devuelve la dirección que tomará Pac-Man en su próximo paso
+enum Direccion entrada_siguiente_direccion(EntradaAutomatica* entrada, const Simulacion* sim) {
+    if (entrada->guion != NULL && entrada->guion[0] != '\0') {
+        // Sigue el guion y vuelve a empezar cuando se termina
+        char letra = entrada->guion[entrada->posicion_guion++];
+        if (entrada->guion[entrada->posicion_guion] == '\0') {
+            entrada->posicion_guion = 0;
+        }
+        switch (letra) {
+            case 'A': return ARRIBA;
+            case 'B': return ABAJO;
+            case 'I': return IZQUIERDA;
+            case 'D': return DERECHA;
+            default: return sim->direccion;
+        }
+    }
+
+    // Entrada aleatoria: mantiene la dirección mientras pueda avanzar y, de vez
+    // en cuando o al chocar con una pared, elige otra dirección transitable
+    Posicion adelante = {sim->pacman.x + direcciones[sim->direccion].x, sim->pacman.y + direcciones[sim->direccion].y};
+    if (vista_transitable(&sim->vista, adelante.x, adelante.y) && aleatorio_siguiente(&entrada->semilla) % 4 != 0) {
+        return sim->direccion;
+    }
+    enum Direccion opciones[4];
+    int cantidad = 0;
+    for (int i = 0; i < 4; i++) {
+        if (vista_transitable(&sim->vista, sim->pacman.x + direcciones[i].x, sim->pacman.y + direcciones[i].y)) {
+            opciones[cantidad++] = (enum Direccion)i;
+        }
+    }
+    return cantidad > 0 ? opciones[aleatorio_siguiente(&entrada->semilla) % cantidad] : sim->direccion;
+}
+
+
+// ======================== Función simular_nivel ========================
+// Simula un nivel con entrada automática hasta que termine o se alcance el
+// máximo de ticks
+// Retorna: Los eventos del último tick (EVENTO_COMPLETADO, EVENTO_MUERTE o ninguno)
+int simular_nivel(Simulacion* sim, EntradaAutomatica* entrada, Uint32 max_ticks) {
+    int eventos = 0;
+    while (!(eventos & (EVENTO_COMPLETADO | EVENTO_MUERTE)) && sim->ticks < max_ticks) {
+        if (simulacion_pacman_se_mueve(sim)) {
+            sim->direccion = entrada_siguiente_direccion(entrada, sim);
+        }
+        eventos = simulacion_tick(sim);
+    }
+    return eventos;
+}
+
+
+// ========================== Grabación de Partidas ==========================
+// Guarda la entrada de una partida para volver a jugarla exactamente igual.
+// Como la simulación es de paso fijo y no usa azar, alcanza con guardar los
+// parámetros de cada nivel y en qué tick se aplicó cada tecla: al reproducir,
+// las mismas entradas en los mismos ticks dan la misma partida. Se graba con
+// --grabar=archivo y se reproduce con --reproducir=archivo (en la ventana a
+// velocidad real, o con --headless tan rápido como se pueda y sin dibujar).
+//
+//     EncabezadoGrabacion
+//     por cada nivel jugado:
+//         NivelGrabado            nivel y parámetros de la partida
+//         Uint32[]                entradas: (tick << 3) | acción
+//         Uint32 puntos, huella   solo después de la entrada que termina el nivel
+//
+// El tick de una entrada es la cantidad de ticks ya simulados cuando se
+// aplicó, así que se aplica justo antes del tick siguiente. Los números se
+// guardan con el orden de bytes de la máquina que grabó (como en los packs).
+
+#define MAGIA_GRABACION "PACGRAB"
+#define VERSION_GRABACION 1
+#define BITS_ACCION 3
+
+// Acciones de una entrada: las cuatro direcciones de Pac-Man y las que terminan el nivel
+enum AccionGrabada {
+    ACCION_SALTAR = NINGUNA,    // Tecla E: saltar el nivel (valen 0-3 las direcciones)
+    ACCION_SALIR,               // Tecla Q o cerrar la ventana
+    ACCION_COMPLETADO,          // Se comieron todos los puntos
+    ACCION_MUERTE               // Un fantasma alcanzó a Pac-Man
+};
+
+// Encabezado del archivo de grabación
+typedef struct {
+    char magia[8];              // MAGIA_GRABACION terminado en '\0'
+    Uint32 version;             // VERSION_GRABACION
+    Uint32 orden_bytes;         // ORDEN_BYTES_PACK
+    Uint32 tamano_nivel;        // sizeof(NivelGrabado) al grabar
+    Uint32 reservado;
+} EncabezadoGrabacion;
+
+// Inicio de un nivel grabado: todo lo que hace falta para volver a crear su simulación
+typedef struct {
+    Sint32 nivel;                               // Número de nivel
+    Sint32 columnas, filas, puntos_totales;     // Para comprobar que el mapa sea el mismo
+    Sint32 modo;                                // Modo de IA efectivo del nivel
+    Sint32 cant_fantasmas;
+    Sint32 velocidad_pacman;
+    Sint32 velocidad_fantasmas[CANT_FANTASMAS];
+    Sint32 salida_fantasmas[CANT_FANTASMAS];
+} NivelGrabado;
+
+// Grabación en curso (archivo NULL si no se graba: las funciones no hacen nada)
+typedef struct {
+    FILE* archivo;
+} Grabacion;
+
+// Resume el estado de una simulación en un número (FNV-1a): posiciones,
+// puntos que quedan y ticks. Sirve para detectar que una reproducción se
+// apartó de la grabación aunque termine con el mismo resultado.
+Uint32 simulacion_huella(const Simulacion* sim) {
+    Uint32 huella = 2166136261u;
+    #define MEZCLAR(valor) (huella = (huella ^ (Uint32)(valor)) * 16777619u)
+    MEZCLAR(sim->ticks);
+    MEZCLAR(sim->puntos.restantes);
+    MEZCLAR(mapa_indice(&sim->mapa, sim->pacman.x, sim->pacman.y));
+    for (int i = 0; i < sim->fantasmas.cantidad; i++) {
+        MEZCLAR(mapa_indice(&sim->mapa, sim->fantasmas.posiciones[i].x, sim->fantasmas.posiciones[i].y));
+    }
+    #undef MEZCLAR
+    return huella;
+}
+
+// ===================== Función grabacion_abrir =====================
+// Crea el archivo de grabación y escribe su encabezado
+// Retorna: 0 si se pudo crear o -1 en caso de error
+int grabacion_abrir(Grabacion* grabacion, const char* ruta) {
+    grabacion->archivo = fopen(ruta, "wb");
+    if (grabacion->archivo == NULL) {
+        printf("No se pudo crear la grabación %s\n", ruta);
+        return -1;
+    }
+    EncabezadoGrabacion encabezado = {MAGIA_GRABACION, VERSION_GRABACION, ORDEN_BYTES_PACK, sizeof(NivelGrabado), 0};
+    fwrite(&encabezado, sizeof(encabezado), 1, grabacion->archivo);
+    return 0;
+}
+
+// Graba el inicio de un nivel con los parámetros de su simulación
+void grabacion_nivel(Grabacion* grabacion, const Simulacion* sim) {
+    if (grabacion->archivo == NULL) {
+        return;
+    }
+    const ParametrosIA* p = &sim->parametros;
+    NivelGrabado nivel = {
+        sim->nivel, sim->mapa.columnas, sim->mapa.filas, sim->puntos.totales,
+        (Sint32)p->modo, p->cant_fantasmas, p->velocidad_pacman,
+        {p->velocidad_fantasmas[0], p->velocidad_fantasmas[1], p->velocidad_fantasmas[2]},
+        {p->salida_fantasmas[0], p->salida_fantasmas[1], p->salida_fantasmas[2]}
+    };
+    fwrite(&nivel, sizeof(nivel), 1, grabacion->archivo);
+}
+
+// Graba una entrada aplicada después de "tick" ticks del nivel; las
+// acciones que terminan el nivel se graban con grabacion_fin
+void grabacion_entrada(Grabacion* grabacion, Uint32 tick, int accion) {
+    if (grabacion->archivo != NULL) {
+        Uint32 codigo = tick << BITS_ACCION | (Uint32)accion;
+        fwrite(&codigo, sizeof(codigo), 1, grabacion->archivo);
+    }
+}
+
+// Graba el fin del nivel con los puntos comidos y la huella del estado final
+void grabacion_fin(Grabacion* grabacion, const Simulacion* sim, enum AccionGrabada accion) {
+    if (grabacion->archivo == NULL) {
+        return;
+    }
+    Uint32 datos[3] = {sim->ticks << BITS_ACCION | (Uint32)accion, (Uint32)puntos_comidos(&sim->puntos), simulacion_huella(sim)};
+    fwrite(datos, sizeof(Uint32), 3, grabacion->archivo);
+    fflush(grabacion->archivo); // Cada nivel terminado queda en el disco aunque el juego se cierre mal
+}
+
+void grabacion_cerrar(Grabacion* grabacion) {
+    if (grabacion->archivo != NULL) {
+        fclose(grabacion->archivo);
+        grabacion->archivo = NULL;
+    }
+}
+
+// ========================== Reproducción de Partidas ==========================
+
+// Valores especiales de reproduccion_aplicar
+#define REPRODUCCION_SIGUE    -1    // El nivel sigue con la simulación
+#define REPRODUCCION_AGOTADA  -2    // No hay más entradas para el nivel (grabación incompleta o reproducción desviada)
+
+// Grabación abierta para reproducir (el archivo entero queda en memoria)
+typedef struct {
+    Uint8* datos;               // Contenido del archivo (NULL si no se reproduce)
+    size_t tamano;              // Bytes del archivo
+    size_t posicion;            // Próximo byte a leer
+    bool en_nivel;              // Hay un nivel empezado cuyo fin todavía no se leyó
+    int diferencias;            // Niveles cuyo final no coincidió con el grabado
+} Reproduccion;
+
+// Lee el próximo Uint32 sin avanzar
+// Retorna: true si había uno
+static bool reproduccion_mirar(const Reproduccion* rep, Uint32* valor) {
+    if (rep->tamano - rep->posicion < sizeof(Uint32)) {
+        return false;
+    }
+    memcpy(valor, rep->datos + rep->posicion, sizeof(Uint32));
+    return true;
+}
+
+// =================== Función reproduccion_abrir ===================
+// Lee la grabación completa y valida su encabezado
+// Retorna: 0 si se pudo abrir o -1 en caso de error
+int reproduccion_abrir(Reproduccion* rep, const char* ruta) {
+    memset(rep, 0, sizeof(*rep));
+    FILE* archivo = fopen(ruta, "rb");
+    long tamano = -1;
+    if (archivo != NULL && fseek(archivo, 0, SEEK_END) == 0) {
+        tamano = ftell(archivo);
+        rewind(archivo);
+    }
+    if (tamano >= (long)sizeof(EncabezadoGrabacion) && (rep->datos = malloc((size_t)tamano)) != NULL &&
+        fread(rep->datos, 1, (size_t)tamano, archivo) == (size_t)tamano) {
+        rep->tamano = (size_t)tamano;
+    }
+    if (archivo != NULL) {
+        fclose(archivo);
+    }
+    if (rep->tamano == 0) {
+        printf("No se pudo leer la grabación %s\n", ruta);
+        free(rep->datos);
+        rep->datos = NULL;
+        return -1;
+    }
+
+    EncabezadoGrabacion encabezado;
+    memcpy(&encabezado, rep->datos, sizeof(encabezado));
+    const char* error = NULL;
+    if (memcmp(encabezado.magia, MAGIA_GRABACION, sizeof(MAGIA_GRABACION)) != 0) {
+        error = "no es una grabación";
+    } else if (encabezado.orden_bytes != ORDEN_BYTES_PACK) {
+        error = "se grabó en una máquina con otro orden de bytes";
+    } else if (encabezado.version != VERSION_GRABACION || encabezado.tamano_nivel != sizeof(NivelGrabado)) {
+        error = "es de otra versión";
+    }
+    if (error != NULL) {
+        printf("La grabación %s %s\n", ruta, error);
+        free(rep->datos);
+        rep->datos = NULL;
+        return -1;
+    }
+    rep->posicion = sizeof(encabezado);
+    return 0;
+}
+
+// =================== Función reproduccion_nivel ===================
+// Lee el inicio del próximo nivel grabado y arma los parámetros de su simulación
+// Retorna: el número de nivel, o -1 si la grabación terminó o el nivel no existe
+int reproduccion_nivel(Reproduccion* rep, ParametrosIA* parametros) {
+    NivelGrabado nivel;
+    if (rep->en_nivel || rep->tamano - rep->posicion < sizeof(nivel)) {
+        return -1;
+    }
+    memcpy(&nivel, rep->datos + rep->posicion, sizeof(nivel));
+    rep->posicion += sizeof(nivel);
+    if (nivel.nivel < 0 || nivel.nivel >= cant_niveles || nivel.modo < IA_CAMPO_DISTANCIAS || nivel.modo > IA_JERARQUICA ||
+        nivel.cant_fantasmas < 1 || nivel.cant_fantasmas > MAX_FANTASMAS) {
+        printf("La grabación tiene un nivel inválido (nivel %d)\n", (int)nivel.nivel + 1);
+        return -1;
+    }
+    Mapa* mapa = &mapas[nivel.nivel];
+    if (nivel.modo == IA_TABLA_SALTOS) {
+        precalcular_saltos = true; // La tabla se arma al cargar el mapa
+    }
+    if (nivel.modo == IA_JERARQUICA) {
+        precalcular_jerarquia = true; // Igual que la jerarquía de clusters
+    }
+    if (cargar_mapa(mapa) == -1) {
+        return -1;
+    }
+    if (mapa->columnas != nivel.columnas || mapa->filas != nivel.filas || mapa->puntos_totales != nivel.puntos_totales) {
+        printf("El mapa del nivel %d (%s) no es el de la grabación\n", (int)nivel.nivel + 1, mapa->nombre);
+        return -1;
+    }
+
+    parametros->modo = (enum ModoIA)nivel.modo;
+    parametros->cant_fantasmas = nivel.cant_fantasmas;
+    parametros->velocidad_pacman = nivel.velocidad_pacman;
+    for (int i = 0; i < CANT_FANTASMAS; i++) {
+        parametros->velocidad_fantasmas[i] = nivel.velocidad_fantasmas[i];
+        parametros->salida_fantasmas[i] = nivel.salida_fantasmas[i];
+    }
+    rep->en_nivel = true;
+    return nivel.nivel;
+}
+
+// ================== Función reproduccion_verificar ==================
+// Lee el fin del nivel grabado y lo compara con el de la simulación.
+// Si la reproducción se desvió, descarta las entradas que quedaban del nivel.
+// Retorna: 0 si coincide o -1 si no
+int reproduccion_verificar(Reproduccion* rep, const Simulacion* sim, enum AccionGrabada accion) {
+    Uint32 codigo;
+    while (reproduccion_mirar(rep, &codigo) && (codigo & ((1u << BITS_ACCION) - 1)) < ACCION_SALTAR) {
+        rep->posicion += sizeof(Uint32);
+    }
+    Uint32 datos[3];
+    if (rep->tamano - rep->posicion < sizeof(datos)) {
+        // La grabación se cortó antes del fin del nivel: no hay con qué comparar
+        rep->posicion = rep->tamano;
+        rep->en_nivel = false;
+        return 0;
+    }
+    memcpy(datos, rep->datos + rep->posicion, sizeof(datos));
+    rep->posicion += sizeof(datos);
+    rep->en_nivel = false;
+
+    if (datos[0] != (sim->ticks << BITS_ACCION | (Uint32)accion) || datos[1] != (Uint32)puntos_comidos(&sim->puntos) ||
+        datos[2] != simulacion_huella(sim)) {
+        printf("La reproducción del nivel %d se apartó de la grabación: terminó en el tick %u con %d puntos "
+               "(grabado: tick %u con %u puntos)\n", sim->nivel + 1, (unsigned)sim->ticks, puntos_comidos(&sim->puntos),
+               (unsigned)(datos[0] >> BITS_ACCION), (unsigned)datos[1]);
+        rep->diferencias++;
+        return -1;
+    }
+    return 0;
+}
+
+// =================== Función reproduccion_aplicar ===================
+// Aplica las entradas grabadas para el próximo tick de la simulación
+// Retorna: ACCION_SALTAR o ACCION_SALIR si el nivel se terminó así en este
+// tick (el fin ya quedó verificado), REPRODUCCION_AGOTADA si no quedan
+// entradas para el nivel, o REPRODUCCION_SIGUE
+int reproduccion_aplicar(Reproduccion* rep, Simulacion* sim) {
+    Uint32 codigo;
+    while (rep->en_nivel && reproduccion_mirar(rep, &codigo)) {
+        Uint32 tick = codigo >> BITS_ACCION;
+        int accion = (int)(codigo & ((1u << BITS_ACCION) - 1));
+        if (tick > sim->ticks) {
+            return REPRODUCCION_SIGUE;
+        }
+        if (tick < sim->ticks || accion >= ACCION_COMPLETADO) {
+            // La simulación no terminó el nivel en el tick en que terminó la
+            // grabación (o pasó una entrada sin aplicarla): se apartó de ella
+            reproduccion_verificar(rep, sim, ACCION_SALIR);
+            return REPRODUCCION_AGOTADA;
+        }
+        if (accion == ACCION_SALTAR || accion == ACCION_SALIR) {
+            reproduccion_verificar(rep, sim, (enum AccionGrabada)accion);
+            return accion;
+        }
+        sim->direccion = (enum Direccion)accion;
+        rep->posicion += sizeof(Uint32);
+    }
+    rep->en_nivel = false;
+    return REPRODUCCION_AGOTADA;
+}
+
+void reproduccion_cerrar(Reproduccion* rep) {
+    free(rep->datos);
+    rep->datos = NULL;
+}
+
+// Acción que terminó un tick de la simulación (como en el juego, completar gana sobre morir)
+static inline int accion_de_eventos(int eventos) {
+    return (eventos & EVENTO_COMPLETADO) ? ACCION_COMPLETADO : (eventos & EVENTO_MUERTE) ? ACCION_MUERTE : REPRODUCCION_SIGUE;
+}
+
+// ====================== Función ejecutar_reproduccion ======================
+// Reproduce una grabación sin ventana, renderizador ni audio, tan rápido
+// como permita la CPU: comprueba que cada nivel termine igual que en la
+// grabación e informa los ticks por segundo (sirve como carga de benchmark)
+// Retorna: 0 si la reproducción coincidió con la grabación o -1 si no
+int ejecutar_reproduccion(const char* ruta) {
+    Reproduccion rep;
+    if (reproduccion_abrir(&rep, ruta) == -1) {
+        return -1;
+    }
+    Uint64 ticks_totales = 0;
+    Uint64 inicio = SDL_GetPerformanceCounter();
+    ParametrosIA parametros;
+    int nivel;
+
+    while ((nivel = reproduccion_nivel(&rep, &parametros)) != -1) {
+        Simulacion sim;
+        if (simulacion_iniciar(&sim, &mapas[nivel], nivel, &parametros) == -1) {
+            reproduccion_cerrar(&rep);
+            return -1;
+        }
+
+        // Cada tick aplica primero las entradas grabadas para él, como el bucle del juego
+        int accion = reproduccion_aplicar(&rep, &sim);
+        while (accion == REPRODUCCION_SIGUE) {
+            accion = accion_de_eventos(simulacion_tick(&sim));
+            if (accion != REPRODUCCION_SIGUE) {
+                reproduccion_verificar(&rep, &sim, (enum AccionGrabada)accion);
+            } else {
+                accion = reproduccion_aplicar(&rep, &sim);
+            }
+        }
+        ticks_totales += sim.ticks;
+
+        const char* resultado = accion == ACCION_COMPLETADO ? "COMPLETADO" : accion == ACCION_MUERTE ? "PERDISTE" :
+                                accion == ACCION_SALTAR ? "SALTADO" : accion == ACCION_SALIR ? "SALIÓ" : "SIN TERMINAR";
+        printf("Nivel %d (%s): %s, puntaje %d/%d, %u ticks\n",
+               nivel + 1, mapas[nivel].nombre, resultado, puntos_comidos(&sim.puntos), sim.puntos.totales, (unsigned)sim.ticks);
+        simulacion_liberar(&sim);
+    }
+
+    double segundos = (double)(SDL_GetPerformanceCounter() - inicio) / (double)SDL_GetPerformanceFrequency();
+    printf("Ticks reproducidos: %llu en %.3f ms (%.0f ticks/s, %.1fx tiempo real)\n",
+           (unsigned long long)ticks_totales, segundos * 1000.0,
+           segundos > 0 ? ticks_totales / segundos : 0.0,
+           segundos > 0 ? ticks_totales * PASO_SIMULACION_MS / 1000.0 / segundos : 0.0);
+    int diferencias = rep.diferencias;
+    reproduccion_cerrar(&rep);
+    if (diferencias > 0) {
+        printf("La reproducción no coincide con la grabación en %d nivel%s\n", diferencias, diferencias == 1 ? "" : "es");
+        return -1;
+    }
+    printf("La reproducción coincide con la grabación\n");
+    return 0;
+}
+
+
+// ======================= Función ejecutar_headless =======================
+// Juega todos los niveles sin ventana, renderizador ni audio, tan rápido
+// como permita la CPU, e informa el resultado de cada nivel y los ticks por segundo
+// Parámetros:
+//   guion: Direcciones a seguir (ver EntradaAutomatica) o NULL para entrada aleatoria
+//   semilla: Semilla del generador pseudoaleatorio
+//   max_ticks: Ticks máximos por nivel antes de abandonarlo
+//   archivo_grabacion: Archivo donde grabar la partida (como en la ventana) o NULL
+// Retorna: 0 si se pudieron cargar los mapas o -1 en caso de error
+int ejecutar_headless(const char* guion, Uint32 semilla, Uint32 max_ticks, const char* archivo_grabacion) {
+    EntradaAutomatica entrada = {guion, 0, semilla != 0 ? semilla : 1};
+    Grabacion grabacion = {NULL};
+    if (archivo_grabacion != NULL && grabacion_abrir(&grabacion, archivo_grabacion) == -1) {
+        return -1;
+    }
+    Uint64 ticks_totales = 0;
+    Uint64 inicio = SDL_GetPerformanceCounter();
+
+    for (int nivel = 0; nivel < cant_niveles; nivel++) {
+        Simulacion sim;
+        if (cargar_mapa(&mapas[nivel]) == -1 || simulacion_iniciar(&sim, &mapas[nivel], nivel, NULL) == -1) {
+            grabacion_cerrar(&grabacion);
+            return -1;
+        }
+        grabacion_nivel(&grabacion, &sim);
+
+        // Como simular_nivel, pero grabando cada cambio de dirección con los ticks ya simulados
+        int eventos = 0;
+        while (!(eventos & (EVENTO_COMPLETADO | EVENTO_MUERTE)) && sim.ticks < max_ticks) {
+            if (simulacion_pacman_se_mueve(&sim)) {
+                enum Direccion direccion = entrada_siguiente_direccion(&entrada, &sim);
+                if (direccion != sim.direccion) {
+                    grabacion_entrada(&grabacion, sim.ticks, direccion);
+                    sim.direccion = direccion;
+                }
+            }
+            eventos = simulacion_tick(&sim);
+        }
+
+        // Un nivel abandonado por max_ticks queda grabado como si se hubiera salido del juego
+        int accion = accion_de_eventos(eventos);
+        grabacion_fin(&grabacion, &sim, accion == REPRODUCCION_SIGUE ? ACCION_SALIR : (enum AccionGrabada)accion);
+        ticks_totales += sim.ticks;
+        simulacion_liberar(&sim);
+
+        const char* resultado = (eventos & EVENTO_COMPLETADO) ? "COMPLETADO" :
+                                (eventos & EVENTO_MUERTE) ? "PERDISTE" : "SIN TERMINAR";
+        printf("Nivel %d (%s): %s, puntaje %d/%d, %u ticks\n",
+               nivel + 1, mapas[nivel].nombre, resultado, puntos_comidos(&sim.puntos), sim.puntos.totales, (unsigned)sim.ticks);
+
+        // Como en el juego, solo se avanza de nivel si se completó el actual
+        if (!(eventos & EVENTO_COMPLETADO)) {
+            break;
+        }
+    }
+    grabacion_cerrar(&grabacion);
+
+    double segundos = (double)(SDL_GetPerformanceCounter() - inicio) / (double)SDL_GetPerformanceFrequency();
+    printf("Ticks simulados: %llu en %.3f ms (%.0f ticks/s, %.1fx tiempo real)\n",
+           (unsigned long long)ticks_totales, segundos * 1000.0,
+           segundos > 0 ? ticks_totales / segundos : 0.0,
+           segundos > 0 ? ticks_totales * PASO_SIMULACION_MS / 1000.0 / segundos : 0.0);
+    return 0;
+}
+
+
+// ========================== Ejecución por Lotes ==========================
+// Corre muchas partidas independientes sin ventana repartidas entre todos
+// los núcleos. Cada partida tiene su propio mapa, semilla y parámetros, y
+// los hilos se balancean con robo de trabajo: cada hilo consume su propia
+// cola de tareas y, cuando se vacía, roba tareas de las colas de los demás.
+
+// Configuración de un lote de partidas
+typedef struct {
+    int partidas;                               // Cantidad de partidas a jugar
+    int hilos;                                  // Hilos de trabajo (0 = uno por núcleo)
+    int nivel;                                  // Nivel de todas las partidas (-1 = alternar entre niveles)
+    Uint32 semilla;                             // Semilla base (la partida i usa una derivada de semilla + i)
+    const char* guion;                          // Guion de entrada o NULL para entrada aleatoria
+    Uint32 max_ticks;                           // Ticks máximos por partida
+    int variacion;                              // Variación aleatoria (en %) de velocidades y retardos
+    int velocidad_pacman;                       // Velocidad de Pac-Man (-1 = la del nivel)
+    int velocidad_fantasmas[CANT_FANTASMAS];    // Velocidades de los fantasmas (-1 = las del nivel)
+    int salida_fantasmas[CANT_FANTASMAS];       // Retardos de salida (-1 = los del nivel)
+    const char* archivo_csv;                    // Archivo donde guardar cada partida o NULL
+} ConfiguracionLote;
+
+// Resultado de una partida del lote
+typedef struct {
+    int nivel;                  // Nivel jugado (-1 si la partida no se pudo jugar)
+    Uint32 semilla;             // Semilla de la partida
+    ParametrosIA parametros;    // Parámetros con los que se jugó
+    int resultado;              // EVENTO_COMPLETADO, EVENTO_MUERTE o 0 si no terminó
+    int puntaje;                // Puntos comidos
+    int puntos_totales;         // Puntos del nivel
+    Uint32 ticks;               // Ticks simulados
+} ResultadoPartida;
+
+// Cola de tareas (índices de partidas) de un hilo. El dueño toma del final
+// y los demás roban del principio; el cerrojo giratorio la protege.
+typedef struct {
+    int* tareas;                // Índices de las partidas asignadas
+    int inicio, fin;            // Tareas pendientes: tareas[inicio..fin-1]
+    SDL_SpinLock cerrojo;       // Cerrojo de la cola
+} ColaTareas;
+
+// Datos compartidos por todos los hilos del lote (solo lectura, salvo las colas)
+typedef struct {
+    const ConfiguracionLote* config;
+    ColaTareas* colas;          // Una cola por hilo
+    int cant_hilos;
+    ResultadoPartida* resultados; // Un resultado por partida (cada uno lo escribe un solo hilo)
+} GrupoTrabajo;
+
+// Estado de un hilo de trabajo
+typedef struct {
+    GrupoTrabajo* grupo;
+    int indice;                 // Índice del hilo (y de su cola)
+    int jugadas;                // Partidas jugadas por este hilo
+    int robadas;                // Partidas robadas de otras colas
+} Trabajador;
+
+// Toma la última tarea de la cola propia (-1 si está vacía)
+int cola_tomar(ColaTareas* cola) {
+    int tarea = -1;
+    SDL_AtomicLock(&cola->cerrojo);
+    if (cola->inicio < cola->fin) {
+        tarea = cola->tareas[--cola->fin];
+    }
+    SDL_AtomicUnlock(&cola->cerrojo);
+    return tarea;
+}
+
+// Roba la primera tarea de la cola de otro hilo (-1 si está vacía)
+int cola_robar(ColaTareas* cola) {
+    int tarea = -1;
+    SDL_AtomicLock(&cola->cerrojo);
+    if (cola->inicio < cola->fin) {
+        tarea = cola->tareas[cola->inicio++];
+    }
+    SDL_AtomicUnlock(&cola->cerrojo);
+    return tarea;
+}
+
+// Aplica una variación aleatoria de +-porcentaje a un valor
+int variar(int valor, int porcentaje, Uint32* semilla) {
+    if (porcentaje <= 0) {
+        return valor;
+    }
+    int rango = valor * porcentaje / 100;
+    int resultado = valor - rango + (int)(aleatorio_siguiente(semilla) % (Uint32)(2 * rango + 1));
+    return resultado > 0 ? resultado : 0;
+}
+
+// ===================== Función jugar_partida_lote =====================
+// Juega la partida número "indice" del lote y guarda su resultado
+void jugar_partida_lote(const ConfiguracionLote* config, int indice, ResultadoPartida* resultado) {
+    int nivel = config->nivel >= 0 ? config->nivel : indice % cant_niveles;
+
+    // Semilla propia de la partida, mezclada para que partidas consecutivas no se parezcan
+    Uint32 semilla = (config->semilla + (Uint32)indice) * 2654435761u;
+    if (semilla == 0) {
+        semilla = 1;
+    }
+
+    // Parámetros del nivel, con los valores fijados por línea de comandos y la variación aleatoria
+    ParametrosIA parametros;
+    parametros_por_defecto(&parametros, nivel);
+    if (config->velocidad_pacman >= 0) {
+        parametros.velocidad_pacman = config->velocidad_pacman;
+    }
+    for (int i = 0; i < CANT_FANTASMAS; i++) {
+        if (config->velocidad_fantasmas[i] >= 0) {
+            parametros.velocidad_fantasmas[i] = config->velocidad_fantasmas[i];
+        }
+        if (config->salida_fantasmas[i] >= 0) {
+            parametros.salida_fantasmas[i] = config->salida_fantasmas[i];
+        }
+        parametros.velocidad_fantasmas[i] = variar(parametros.velocidad_fantasmas[i], config->variacion, &semilla);
+        parametros.salida_fantasmas[i] = variar(parametros.salida_fantasmas[i], config->variacion, &semilla);
+    }
+
+    // Cada partida tiene su propia simulación; las rejillas del mapa se comparten, de solo lectura, con la plantilla
+    // Si no hay memoria, la partida queda marcada como fallida y no cuenta en el resumen por nivel
+    memset(resultado, 0, sizeof(*resultado));
+    resultado->nivel = -1;
+    resultado->semilla = semilla;
+    Simulacion* sim = malloc(sizeof(Simulacion));
+    if (sim == NULL) {
+        return;
+    }
+    EntradaAutomatica entrada = {config->guion, 0, semilla};
+    if (simulacion_iniciar(sim, &mapas[nivel], nivel, &parametros) == -1) {
+        free(sim);
+        return;
+    }
+    int eventos = simular_nivel(sim, &entrada, config->max_ticks);
+
+    resultado->nivel = nivel;
+    resultado->semilla = semilla;
+    resultado->parametros = parametros;
+    resultado->resultado = eventos & EVENTO_COMPLETADO ? EVENTO_COMPLETADO : (eventos & EVENTO_MUERTE);
+    resultado->puntaje = puntos_comidos(&sim->puntos);
+    resultado->puntos_totales = sim->puntos.totales;
+    resultado->ticks = sim->ticks;
+
+    simulacion_liberar(sim);
+    free(sim);
+}
+
+// Función que ejecuta cada hilo de trabajo del lote
+int hilo_trabajo_lote(void* datos) {
+    Trabajador* trabajador = datos;
+    GrupoTrabajo* grupo = trabajador->grupo;
 
-        // Limpia la posición de Pac-Man
-        dibujar_rectangulo(pacman.x, pacman.y, 100, COLOR_FONDO);
+    for (;;) {
+        int tarea = cola_tomar(&grupo->colas[trabajador->indice]);
 
-        // Dibuja Pac-Man con un tamaño decreciente
-        dibujar_rectangulo(pacman.x, pacman.y, i, COLOR_PACMAN);
+        // Si la cola propia se vació, intenta robar de las demás, empezando por la siguiente
+        for (int k = 1; tarea < 0 && k < grupo->cant_hilos; k++) {
+            tarea = cola_robar(&grupo->colas[(trabajador->indice + k) % grupo->cant_hilos]);
+            if (tarea >= 0) {
+                trabajador->robadas++;
+            }
+        }
+
+        // No se agregan tareas durante el lote: si todas las colas están vacías, el trabajo terminó
+        if (tarea < 0) {
+            break;
+        }
+        jugar_partida_lote(grupo->config, tarea, &grupo->resultados[tarea]);
+        trabajador->jugadas++;
+    }
+    return 0;
+}
 
-        // Muestra el cambio en pantalla
-        SDL_RenderPresent(renderer);
+// ===================== Función guardar_resultados_csv =====================
+// Guarda una línea por partida con sus parámetros y su resultado
+int guardar_resultados_csv(const char* archivo, const ResultadoPartida* resultados, int cantidad) {
+    FILE* file = fopen(archivo, "w");
+    if (!file) {
+        perror("No se pudo crear el archivo de resultados");
+        return -1;
+    }
+    fprintf(file, "partida,nivel,semilla,velocidad_pacman");
+    for (int i = 0; i < CANT_FANTASMAS; i++) {
+        fprintf(file, ",velocidad_fantasma%d,salida_fantasma%d", i + 1, i + 1);
+    }
+    fprintf(file, ",fantasmas,resultado,puntaje,puntos_totales,ticks\n");
 
-        // Espera un breve periodo para crear el efecto de animación
-        SDL_Delay(50);
+    for (int p = 0; p < cantidad; p++) {
+        const ResultadoPartida* r = &resultados[p];
+        fprintf(file, "%d,%d,%u,%d", p, r->nivel + 1, (unsigned)r->semilla, r->parametros.velocidad_pacman);
+        for (int i = 0; i < CANT_FANTASMAS; i++) {
+            fprintf(file, ",%d,%d", r->parametros.velocidad_fantasmas[i], r->parametros.salida_fantasmas[i]);
+        }
+        fprintf(file, ",%d,%s,%d,%d,%u\n", r->parametros.cant_fantasmas,
+                r->nivel < 0 ? "fallida" :
+                r->resultado == EVENTO_COMPLETADO ? "completado" : r->resultado == EVENTO_MUERTE ? "muerte" : "sin_terminar",
+                r->puntaje, r->puntos_totales, (unsigned)r->ticks);
     }
+    fclose(file);
+    return 0;
+}
 
-    // Limpia la pantalla después de la animación
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    dibujar_rectangulo(pacman.x, pacman.y, 0, COLOR_FONDO);
-    SDL_RenderPresent(renderer);
+// ======================= Función ejecutar_lote =======================
+// Juega todas las partidas del lote en paralelo e imprime un resumen por nivel
+// Retorna: 0 si el lote se completó o -1 en caso de error
+int ejecutar_lote(const ConfiguracionLote* config) {
+    // Los mapas se cargan una sola vez; durante el lote son de solo lectura
+    for (int i = 0; i < cant_niveles; i++) {
+        if (cargar_mapa(&mapas[i]) == -1) {
+            return -1;
+        }
+    }
+
+    int cant_hilos = config->hilos > 0 ? config->hilos : SDL_GetCPUCount();
+    if (cant_hilos < 1) {
+        cant_hilos = 1;
+    }
+    if (cant_hilos > config->partidas) {
+        cant_hilos = config->partidas > 0 ? config->partidas : 1;
+    }
+
+    ResultadoPartida* resultados = calloc(config->partidas > 0 ? config->partidas : 1, sizeof(ResultadoPartida));
+    int* tareas = malloc((config->partidas > 0 ? config->partidas : 1) * sizeof(int));
+    ColaTareas* colas = calloc(cant_hilos, sizeof(ColaTareas));
+    Trabajador* trabajadores = calloc(cant_hilos, sizeof(Trabajador));
+    SDL_Thread** hilos = calloc(cant_hilos, sizeof(SDL_Thread*));
+    if (!resultados || !tareas || !colas || !trabajadores || !hilos) {
+        printf("Error: no hay memoria para el lote\n");
+        free(resultados); free(tareas); free(colas); free(trabajadores); free(hilos);
+        return -1;
+    }
+
+    // Reparte las partidas en bloques contiguos, uno por hilo
+    for (int p = 0; p < config->partidas; p++) {
+        tareas[p] = p;
+    }
+    for (int h = 0; h < cant_hilos; h++) {
+        colas[h].tareas = tareas;
+        colas[h].inicio = (int)((long long)config->partidas * h / cant_hilos);
+        colas[h].fin = (int)((long long)config->partidas * (h + 1) / cant_hilos);
+    }
+    GrupoTrabajo grupo = {config, colas, cant_hilos, resultados};
+
+    // Lanza los hilos y espera a que terminen
+    Uint64 inicio = SDL_GetPerformanceCounter();
+    for (int h = 0; h < cant_hilos; h++) {
+        trabajadores[h].grupo = &grupo;
+        trabajadores[h].indice = h;
+        hilos[h] = SDL_CreateThread(hilo_trabajo_lote, "lote", &trabajadores[h]);
+        if (hilos[h] == NULL) {
+            // Sin hilo propio, sus tareas las roban los demás (o este mismo hilo, más abajo)
+            printf("Error al crear un hilo de trabajo: %s\n", SDL_GetError());
+        }
+    }
+    Trabajador principal = {&grupo, 0, 0, 0};
+    hilo_trabajo_lote(&principal); // El hilo principal también ayuda con lo que quede
+    int robadas = principal.robadas;
+    for (int h = 0; h < cant_hilos; h++) {
+        SDL_WaitThread(hilos[h], NULL);
+        robadas += trabajadores[h].robadas;
+    }
+    double segundos = (double)(SDL_GetPerformanceCounter() - inicio) / (double)SDL_GetPerformanceFrequency();
+
+    // Resumen por nivel
+    Uint64 ticks_totales = 0;
+    printf("%-6s %9s %11s %9s %12s %13s %14s\n",
+           "Nivel", "Partidas", "Completado", "Muerte", "Sin terminar", "Ticks medios", "Puntaje medio");
+    for (int nivel = 0; nivel < cant_niveles; nivel++) {
+        int partidas = 0, completadas = 0, muertes = 0;
+        double ticks = 0, fraccion_puntaje = 0;
+        for (int p = 0; p < config->partidas; p++) {
+            const ResultadoPartida* r = &resultados[p];
+            if (r->nivel != nivel) {
+                continue;
+            }
+            partidas++;
+            completadas += r->resultado == EVENTO_COMPLETADO;
+            muertes += r->resultado == EVENTO_MUERTE;
+            ticks += r->ticks;
+            fraccion_puntaje += r->puntos_totales > 0 ? (double)r->puntaje / r->puntos_totales : 0.0;
+        }
+        if (partidas == 0) {
+            continue;
+        }
+        ticks_totales += (Uint64)ticks;
+        printf("%-6d %9d %10.1f%% %8.1f%% %11.1f%% %13.0f %13.1f%%\n",
+               nivel + 1, partidas, 100.0 * completadas / partidas, 100.0 * muertes / partidas,
+               100.0 * (partidas - completadas - muertes) / partidas, ticks / partidas,
+               100.0 * fraccion_puntaje / partidas);
+    }
+    printf("%d partidas en %.3f s con %d hilos (%d robadas): %.0f partidas/s, %.0f ticks/s\n",
+           config->partidas, segundos, cant_hilos, robadas,
+           segundos > 0 ? config->partidas / segundos : 0.0,
+           segundos > 0 ? ticks_totales / segundos : 0.0);
+
+    // Las partidas que no se pudieron jugar no entran en el resumen: se informan aparte
+    int fallidas = 0;
+    for (int p = 0; p < config->partidas; p++) {
+        fallidas += resultados[p].nivel < 0;
+    }
+    if (fallidas > 0) {
+        printf("Error: %d partidas no se pudieron jugar por falta de memoria\n", fallidas);
+    }
+
+    int estado = fallidas > 0 ? -1 : 0;
+    if (config->archivo_csv != NULL) {
+        if (guardar_resultados_csv(config->archivo_csv, resultados, config->partidas) == -1) {
+            estado = -1;
+        }
+    }
 
-    // Muestra el mensaje "GAME OVER"
-    mostrar_mensaje(mapa, "PERDISTE", COLOR_GHOST);
+    free(resultados);
+    free(tareas);
+    free(colas);
+    free(trabajadores);
+    free(hilos);
+    return estado;
 }
 
 
+// ======================= Función medir_costo_tick =======================
+// Mide el costo promedio (en nanosegundos) de un tick de movimiento e IA sobre
+// un mapa: Pac-Man camina al azar y todos los fantasmas calculan su siguiente
+// paso y validan el movimiento en cada tick (el peor caso del bucle del nivel)
+// Retorna: el costo por tick o -1 si no hay memoria para la IA
+double medir_costo_tick(const Mapa* mapa, enum ModoIA modo, int cant_fantasmas, int ticks) {
+    modo = ia_modo_efectivo(modo, mapa);
+    int celdas = mapa_celdas(mapa);
+    ParametrosIA parametros;
+    parametros_por_defecto(&parametros, 0);
+    parametros.cant_fantasmas = cant_fantasmas;
+    Arena arena;
+    IAFantasmas ia;
+    Fantasmas fantasmas;
+    Uint16* ocupacion = NULL;
+    if (arena_iniciar(&arena, ocupacion_memoria(celdas) + fantasmas_memoria(cant_fantasmas) +
+                              ia_memoria(modo, mapa, cant_fantasmas)) == -1 ||
+        (ocupacion = ocupacion_iniciar(&arena, mapa)) == NULL ||
+        fantasmas_iniciar(&fantasmas, &arena, mapa, &parametros, ocupacion) == -1 ||
+        ia_iniciar(&ia, modo, &arena, mapa, cant_fantasmas) == -1) {
+        arena_liberar(&arena);
+        return -1.0;
+    }
+    VistaMapa vista_local = vista_mapa(mapa);
+    const VistaMapa* vista = &vista_local;
+    Posicion pacman = mapa->inicio_pacman;
+    srand(12345); // Semilla fija para que todas las mediciones recorran lo mismo
+
+    Uint64 inicio = SDL_GetPerformanceCounter();
+    for (int t = 0; t < ticks; t++) {
+        // Pac-Man intenta moverse en una dirección al azar
+        int d = rand() % 4;
+        Posicion nueva_posicion = {pacman.x + direcciones[d].x, pacman.y + direcciones[d].y};
+        if (es_posicion_valida(vista, nueva_posicion, ocupacion)) {
+            pacman = nueva_posicion;
+            ia_seguir_objetivo(&ia, vista, pacman);
+        }
 
-// ====================== Función es_posicion_valida ======================
-// Verifica si una posición es válida para moverse (no hay obstáculos ni fantasmas)
-// Parámetros:
-//   mapa: Estructura del mapa
-//   pos: Posición a verificar
-//   ghost1, ghost2, ghost3: Posiciones de los fantasmas
-int es_posicion_valida(Mapa mapa, Posicion pos, Posicion ghost1, Posicion ghost2, Posicion ghost3) {
-    // Verifica que la posición esté dentro de los límites del mapa y no haya obstáculos ni fantasmas
-    return (pos.x >= 0 && pos.x < mapa.columnas &&
-            pos.y >= 0 && pos.y < mapa.filas &&
-            mapa.maze[pos.y][pos.x] != OBSTACLE &&
-            !(pos.x == ghost1.x && pos.y == ghost1.y) &&
-            !(pos.x == ghost2.x && pos.y == ghost2.y) &&
-            !(pos.x == ghost3.x && pos.y == ghost3.y));
+        // Cada fantasma calcula su siguiente paso y valida el movimiento
+        for (int i = 0; i < cant_fantasmas; i++) {
+            Posicion paso = siguiente_paso_fantasma(&ia, vista, i, fantasmas.posiciones[i], pacman);
+            if (es_posicion_valida(vista, paso, ocupacion)) {
+                fantasmas_mover(&fantasmas, ocupacion, mapa->paso, i, paso);
+            }
+        }
+
+        // Si algún fantasma alcanza a Pac-Man, se reinician las posiciones
+        if (ocupacion_hay_fantasma(ocupacion, pacman.y * mapa->paso + pacman.x)) {
+            pacman = mapa->inicio_pacman;
+            for (int i = 0; i < cant_fantasmas; i++) {
+                fantasmas_mover(&fantasmas, ocupacion, mapa->paso, i, mapa->inicio_fantasmas[i % CANT_FANTASMAS]);
+            }
+        }
+    }
+    Uint64 fin = SDL_GetPerformanceCounter();
+    arena_liberar(&arena);
+    return (double)(fin - inicio) * 1e9 / (double)SDL_GetPerformanceFrequency() / ticks;
 }
 
-// =================== Función distancia_manhattan ===================
-// Calcula la distancia de Manhattan (heurística) entre dos posiciones
-// Parámetros:
-//   a, b: Dos posiciones del mapa
-// Retorna: La distancia de Manhattan entre las posiciones
-int distancia_manhattan(Posicion a, Posicion b) {
-    // Distancia de Manhattan: |x1 - x2| + |y1 - y2|
-    return abs(a.x - b.x) + abs(a.y - b.y);
+// ======================= Función ejecutar_benchmark =======================
+// Mide el costo por tick de movimiento e IA en todos los niveles y con
+// todas las estrategias de IA, e imprime los resultados por consola
+// (las columnas de la tabla y de HPA* quedan en "-" si no entran en memoria)
+// Retorna: 0 si se pudieron cargar todos los mapas o -1 en caso de error
+int ejecutar_benchmark(int ticks) {
+    printf("%-12s %14s %14s %14s %14s\n", "Mapa", "campo ns/tick", "A* ns/tick", "tabla ns/tick", "HPA* ns/tick");
+    for (int i = 0; i < cant_niveles; i++) {
+        if (cargar_mapa(&mapas[i]) == -1) {
+            return -1;
+        }
+        double costo_campo = medir_costo_tick(&mapas[i], IA_CAMPO_DISTANCIAS, fantasmas_del_nivel(i), ticks);
+        double costo_a_estrella = medir_costo_tick(&mapas[i], IA_A_ESTRELLA, fantasmas_del_nivel(i), ticks);
+        if (costo_campo < 0 || costo_a_estrella < 0) {
+            return -1;
+        }
+        if (mapas[i].saltos == NULL) {
+            saltos_construir(&mapas[i]);
+        }
+        if (mapas[i].jerarquia == NULL) {
+            jerarquia_construir(&mapas[i]);
+        }
+        printf("%-12s %14.1f %14.1f", mapas[i].nombre, costo_campo, costo_a_estrella);
+        if (mapas[i].saltos != NULL) {
+            printf(" %14.1f", medir_costo_tick(&mapas[i], IA_TABLA_SALTOS, fantasmas_del_nivel(i), ticks));
+        } else {
+            printf(" %14s", "-");
+        }
+        if (mapas[i].jerarquia != NULL) {
+            printf(" %14.1f\n", medir_costo_tick(&mapas[i], IA_JERARQUICA, fantasmas_del_nivel(i), ticks));
+        } else {
+            printf(" %14s\n", "-");
+        }
+    }
+    return 0;
+}
+
+// ========================== Microbenchmarks ==========================
+// Mide por separado los núcleos más usados (la búsqueda A*, la búsqueda
+// jerárquica y la actualización de sus clusters, la validación de
+// movimientos, la carga de mapas y el dibujo de un cuadro) sobre los mapas
+// del juego y sobre laberintos sintéticos de distintos tamaños, e informa por
+// consola y opcionalmente en JSON (--json=archivo) el costo por operación,
+// los nodos expandidos y los pedidos de memoria, para comparar entre versiones.
+// El dibujo usa el renderizador por software de SDL sobre una superficie en
+// memoria, así que se puede medir en máquinas sin GPU ni pantalla.
+
+#define TIEMPO_MINIMO_MICRO_MS 200              // Cada medición repite su núcleo al menos este tiempo
+#define OPERACIONES_MINIMAS_MICRO 5             // ... y al menos estas veces
+#define MUESTRA_POSICIONES_MICRO 4096           // Posiciones al azar para es_posicion_valida
+#define PIXELES_MAXIMOS_MICRO (4096 * 4096)     // Mapas más grandes no se dibujan (la superficie no entraría en memoria)
+
+// Tamaños de los laberintos sintéticos (columnas x filas)
+static const int tamanos_laberintos[][2] = {{25, 13}, {101, 51}, {250, 250}, {500, 500}, {1000, 1000}, {2000, 2000}};
+
+// Resultado de medir un núcleo sobre un mapa
+typedef struct {
+    const char* nucleo;         // Función medida
+    char mapa[64];              // Nombre del mapa
+    int columnas, filas;        // Tamaño del mapa
+    Uint64 operaciones;         // Veces que se ejecutó el núcleo
+    double ns_por_op;           // Costo promedio por operación
+    double nodos_por_op;        // Nodos expandidos por operación (solo A*)
+    double asignaciones_por_op; // Pedidos de memoria por operación
+} ResultadoMicro;
+
+// Resultados acumulados de todas las mediciones
+typedef struct {
+    ResultadoMicro* resultados;
+    int cantidad, capacidad;
+} InformeMicro;
+
+// Medición en curso de un núcleo
+typedef struct {
+    Uint64 inicio;              // Contador de rendimiento al empezar
+    Uint64 limite;              // Cuentas del contador que dura como mínimo la medición
+    Uint64 operaciones;         // Operaciones hechas
+    int asignaciones;           // Contador de asignaciones al empezar
+} Medicion;
+
+static void medicion_iniciar(Medicion* m) {
+    m->limite = SDL_GetPerformanceFrequency() * TIEMPO_MINIMO_MICRO_MS / 1000;
+    m->operaciones = 0;
+    m->asignaciones = SDL_AtomicGet(&asignaciones);
+    m->inicio = SDL_GetPerformanceCounter();
 }
 
+// Indica si hay que seguir midiendo (se consulta cada tanto, no en cada operación de los núcleos más cortos)
+static bool medicion_sigue(const Medicion* m) {
+    return m->operaciones < OPERACIONES_MINIMAS_MICRO || SDL_GetPerformanceCounter() - m->inicio < m->limite;
+}
 
-// ================= Algoritmo A* =================
-// Función para encontrar el camino más corto entre un fantasma y Pac-Man
-// Parámetros:
-//   mapa: Estructura del mapa
-//   inicio: Posición inicial del fantasma
-//   objetivo: Posición de Pac-Man
-//   camino: Arreglo para almacenar el camino encontrado
-// Retorna: La longitud del camino encontrado o -1 si no hay camino
-int a_estrella(Mapa mapa, Posicion inicio, Posicion objetivo, Posicion camino[LONGITUD_MAXIMA_CAMINO]) {
+// ===================== Función medicion_terminar =====================
+// Cierra una medición, la imprime y la agrega al informe
+static void medicion_terminar(const Medicion* m, InformeMicro* informe, const char* nucleo, const char* etiqueta,
+                              const Mapa* mapa, Uint64 nodos) {
+    double ns = (double)(SDL_GetPerformanceCounter() - m->inicio) * 1e9 / (double)SDL_GetPerformanceFrequency();
+    ResultadoMicro r = {nucleo, "", mapa->columnas, mapa->filas, m->operaciones, ns / m->operaciones,
+                        (double)nodos / m->operaciones,
+                        (double)(SDL_AtomicGet(&asignaciones) - m->asignaciones) / m->operaciones};
+    snprintf(r.mapa, sizeof(r.mapa), "%s", etiqueta);
+    printf("%-28s %-24s %5dx%-5d %12.1f %12.1f %10.2f %10llu\n", r.nucleo, r.mapa, r.columnas, r.filas,
+           r.ns_por_op, r.nodos_por_op, r.asignaciones_por_op, (unsigned long long)r.operaciones);
+    if (asegurar_capacidad((void**)&informe->resultados, &informe->capacidad, informe->cantidad + 1, sizeof(ResultadoMicro))) {
+        informe->resultados[informe->cantidad++] = r;
+    }
+}
 
-    // Inicializa la lista cerrada para marcar las posiciones visitadas
-    int lista_cerrada[FILAS][COLUMNAS] = {0};
+// Elige al azar una celda libre del mapa
+static Posicion celda_libre_al_azar(const Mapa* mapa, Uint32* semilla) {
+    for (;;) {
+        Posicion p = {(int)(aleatorio_siguiente(semilla) % mapa->columnas), (int)(aleatorio_siguiente(semilla) % mapa->filas)};
+        if (!mapa_es_pared(mapa, mapa_indice(mapa, p.x, p.y))) {
+            return p;
+        }
+    }
+}
 
-    // Variable para almacenar la longitud del camino
-    int longitud_camino = 0;
+// ==================== Función crear_archivo_temporal ====================
+// Crea en la carpeta temporal del sistema un archivo con un nombre que no
+// existía (nunca pisa un archivo del usuario) y deja su ruta en "ruta"
+// Retorna: el archivo abierto para escribir o NULL en caso de error
+FILE* crear_archivo_temporal(char* ruta, size_t tamano) {
+#ifdef _WIN32
+    char carpeta[MAX_PATH];
+    DWORD largo = GetTempPathA(sizeof(carpeta), carpeta);
+    if (largo == 0 || largo >= sizeof(carpeta) || tamano < MAX_PATH || GetTempFileNameA(carpeta, "pac", 0, ruta) == 0) {
+        return NULL;
+    }
+    FILE* archivo = fopen(ruta, "w"); // GetTempFileNameA ya creó el archivo, vacío y con un nombre único
+#else
+    const char* carpeta = getenv("TMPDIR");
+    if (carpeta == NULL || carpeta[0] == '\0') {
+        carpeta = "/tmp";
+    }
+    if (snprintf(ruta, tamano, "%s/pacman_laberinto_XXXXXX", carpeta) >= (int)tamano) {
+        return NULL;
+    }
+    int descriptor = mkstemp(ruta); // Crea el archivo solo si el nombre no existía
+    if (descriptor == -1) {
+        return NULL;
+    }
+    FILE* archivo = fdopen(descriptor, "w");
+    if (archivo == NULL) {
+        close(descriptor);
+    }
+#endif
+    if (archivo == NULL) {
+        remove(ruta);
+    }
+    return archivo;
+}
 
-    // Arreglo para registrar el recorrido del camino
-    Posicion recorrido[FILAS][COLUMNAS] = {{-1, -1}};
-    
-    // Variable que indica si se ha encontrado el camino
-    int encontrado = 0;
-
-    // Estructura de datos para los nodos del algoritmo A*
-    typedef struct {
-        Posicion pos; // Posición del nodo
-        int g; // Costo desde el nodo inicial hasta este nodo
-        int h; // Heurística: Distancia estimada desde este nodo hasta el objetivo
-        int f; // Costo total: g + h
-    } Nodo;
-
-    // Lista abierta para almacenar los nodos por explorar
-    Nodo lista_abierta[mapa.filas * mapa.columnas];
-    int contador_abierta = 0;
-
-    // Inicializa el nodo de inicio
-    Nodo nodo_inicio = {inicio, 0, distancia_manhattan(inicio, objetivo), distancia_manhattan(inicio, objetivo)};
-    
-    // Agrega el nodo inicial a la lista abierta
-    lista_abierta[contador_abierta++] = nodo_inicio;
+// ==================== Función generar_laberinto ====================
+// Escribe en un archivo temporal nuevo (ver crear_archivo_temporal), cuya
+// ruta deja en "ruta", un laberinto sintético en el formato de los mapas: un
+// laberinto perfecto (recorrido en profundidad con vuelta atrás) al que se le
+// abren algunas paredes más para que haya ciclos, como en los mapas del juego.
+// Pac-Man arranca en una esquina, los fantasmas en el centro y el resto del
+// camino tiene puntos. Con la misma semilla siempre sale el mismo laberinto.
+// Retorna: 0 si se pudo escribir o -1 en caso de error (y entonces no queda ningún archivo)
+int generar_laberinto(char* ruta, size_t tamano_ruta, int columnas, int filas, Uint32 semilla) {
+    char* celdas = malloc((size_t)columnas * filas);
+    int* pila = malloc(((size_t)columnas / 2 + 1) * (filas / 2 + 1) * sizeof(int));
+    FILE* archivo = celdas != NULL && pila != NULL ? crear_archivo_temporal(ruta, tamano_ruta) : NULL;
+    if (archivo == NULL) {
+        free(celdas);
+        free(pila);
+        return -1;
+    }
+    memset(celdas, OBSTACLE, (size_t)columnas * filas);
+
+    // Las celdas del laberinto son las de coordenadas impares; se cavan recorriendo en profundidad
+    int cantidad = 0;
+    pila[cantidad++] = columnas + 1;
+    celdas[columnas + 1] = POINT;
+    const int saltos[4][2] = {{0, -2}, {0, 2}, {-2, 0}, {2, 0}};
+    while (cantidad > 0) {
+        int actual = pila[cantidad - 1], x = actual % columnas, y = actual / columnas;
+        int opciones[4], cant_opciones = 0;
+        for (int d = 0; d < 4; d++) {
+            int vx = x + saltos[d][0], vy = y + saltos[d][1];
+            if (vx > 0 && vx < columnas - 1 && vy > 0 && vy < filas - 1 && celdas[vy * columnas + vx] == OBSTACLE) {
+                opciones[cant_opciones++] = vy * columnas + vx;
+            }
+        }
+        if (cant_opciones == 0) {
+            cantidad--;
+            continue;
+        }
+        int siguiente = opciones[aleatorio_siguiente(&semilla) % cant_opciones];
+        celdas[(actual + siguiente) / 2] = POINT; // La pared entre las dos celdas
+        celdas[siguiente] = POINT;
+        pila[cantidad++] = siguiente;
+    }
 
-    // Bucle principal del algoritmo A*
-    while (contador_abierta > 0 && !encontrado) {
-        // Encuentra el nodo con el menor costo total (f) en la lista abierta
-        int indice_min = 0;
-        for (int i = 1; i < contador_abierta; i++) {
-            if (lista_abierta[i].f < lista_abierta[indice_min].f) {
-                indice_min = i;
+    // Abre una de cada ocho paredes que separan dos pasillos para formar ciclos
+    for (int y = 1; y < filas - 1; y++) {
+        for (int x = 1; x < columnas - 1; x++) {
+            int i = y * columnas + x;
+            bool entre_pasillos = (celdas[i - 1] == POINT && celdas[i + 1] == POINT && y % 2 == 1) ||
+                                  (celdas[i - columnas] == POINT && celdas[i + columnas] == POINT && x % 2 == 1);
+            if (celdas[i] == OBSTACLE && entre_pasillos && aleatorio_siguiente(&semilla) % 8 == 0) {
+                celdas[i] = POINT;
             }
         }
+    }
+
+    // Posiciones iniciales: Pac-Man en la esquina y los fantasmas en celdas impares del centro
+    int cx = (columnas / 2) | 1, cy = (filas / 2) | 1;
+    celdas[columnas + 1] = PACMAN;
+    celdas[cy * columnas + cx] = GHOST;
+    celdas[cy * columnas + cx - 2] = GHOST2;
+    celdas[cy * columnas + cx + 2] = GHOST3;
+    int puntos = 0;
+    for (int i = 0; i < columnas * filas; i++) {
+        puntos += celdas[i] == POINT;
+    }
 
-        // Extrae el nodo con el menor costo de la lista abierta
-        Nodo nodo_actual = lista_abierta[indice_min];
-        lista_abierta[indice_min] = lista_abierta[--contador_abierta]; // Reduce el tamaño de la lista abierta
+    fprintf(archivo, "%s %d %d %d\n", ENCABEZADO_MAPA, columnas, filas, puntos);
+    for (int y = 0; y < filas; y++) {
+        fwrite(celdas + (size_t)y * columnas, 1, columnas, archivo);
+        fputc('\n', archivo);
+    }
+    int resultado = ferror(archivo) ? -1 : 0;
+    if (fclose(archivo) != 0 || resultado == -1) {
+        remove(ruta);
+        resultado = -1;
+    }
+    free(celdas);
+    free(pila);
+    return resultado;
+}
 
-        // Marca el nodo actual como visitado en la lista cerrada
-        lista_cerrada[nodo_actual.pos.y][nodo_actual.pos.x] = 1;
+// ==================== Función micro_medir_mapa ====================
+// Mide todos los núcleos sobre un mapa ya cargado; "etiqueta" es el nombre
+// del mapa en el informe
+// Retorna: 0 si se pudo medir o -1 si no hay memoria
+int micro_medir_mapa(Mapa* mapa, const char* etiqueta, InformeMicro* informe) {
+    Medicion m;
+    Uint32 semilla = 12345; // Semilla fija: todas las versiones miden los mismos pares de celdas
+
+    // ---- cargar_mapa: leer el archivo y armar paredes, puntos y vecinos ----
+    // (con leer_mapa, porque cargar_mapa conserva el mapa ya cargado y no lo volvería a leer)
+    medicion_iniciar(&m);
+    for (; medicion_sigue(&m); m.operaciones++) {
+        if (leer_mapa(mapa) == -1) {
+            return -1;
+        }
+    }
+    medicion_terminar(&m, informe, "cargar_mapa", etiqueta, mapa, 0);
+    int celdas = mapa_celdas(mapa);
+    if (mapa->jerarquia == NULL) {
+        jerarquia_construir(mapa); // Sin jerarquía (no entra en memoria) no se mide la búsqueda jerárquica
+    }
+    VistaMapa vista = vista_mapa(mapa); // Después de recargar: apunta a las rejillas de la última carga
+
+    Arena arena;
+    MotorAEstrella motor;
+    BusquedaJerarquica busqueda;
+    CampoLocal cerca = {.origen = -1};
+    PuntosNivel puntos;
+    Uint16* ocupacion = NULL;
+    size_t memoria_jerarquica = mapa->jerarquia != NULL ? busqueda_jerarquica_memoria(mapa) : 0;
+    if (arena_iniciar(&arena, ocupacion_memoria(celdas) + motor_memoria(celdas) + puntos_memoria(celdas) + memoria_jerarquica) == -1 ||
+        (ocupacion = ocupacion_iniciar(&arena, mapa)) == NULL || motor_iniciar(&motor, &arena, celdas) == -1 ||
+        puntos_iniciar(&puntos, &arena, mapa) == -1 ||
+        (mapa->jerarquia != NULL && busqueda_jerarquica_iniciar(&busqueda, &arena, mapa) == -1)) {
+        arena_liberar(&arena);
+        return -1;
+    }
 
-        // Si se ha alcanzado el objetivo, se reconstruye el camino
-        if (nodo_actual.pos.x == objetivo.x && nodo_actual.pos.y == objetivo.y) {
-            Posicion pos = objetivo;
-            while (pos.x != inicio.x || pos.y != inicio.y) {
-                camino[longitud_camino++] = pos; // Agrega la posición al camino
-                pos = recorrido[pos.y][pos.x]; // Sigue el rastro del recorrido
+    // ---- es_posicion_valida: posiciones al azar, también fuera del mapa ----
+    Posicion muestra[MUESTRA_POSICIONES_MICRO];
+    for (int i = 0; i < MUESTRA_POSICIONES_MICRO; i++) {
+        muestra[i].x = (int)(aleatorio_siguiente(&semilla) % (mapa->columnas + 2)) - 1;
+        muestra[i].y = (int)(aleatorio_siguiente(&semilla) % (mapa->filas + 2)) - 1;
+    }
+    volatile int validas = 0; // Evita que el compilador descarte las llamadas
+    medicion_iniciar(&m);
+    while (medicion_sigue(&m)) {
+        int suma = 0;
+        for (int i = 0; i < MUESTRA_POSICIONES_MICRO; i++) {
+            suma += es_posicion_valida(&vista, muestra[i], ocupacion);
+        }
+        validas += suma;
+        m.operaciones += MUESTRA_POSICIONES_MICRO;
+    }
+    medicion_terminar(&m, informe, "es_posicion_valida", etiqueta, mapa, 0);
+
+    // ---- a_estrella: pares de celdas libres al azar, cada búsqueda desde cero ----
+    medicion_iniciar(&m);
+    Uint64 expandidos = motor.expandidos;
+    for (; medicion_sigue(&m); m.operaciones++) {
+        Posicion inicio = celda_libre_al_azar(mapa, &semilla), objetivo = celda_libre_al_azar(mapa, &semilla);
+        motor.raiz = -1; // Sin reutilizar el árbol de la búsqueda anterior
+        a_estrella(&motor, &vista, inicio, objetivo);
+    }
+    medicion_terminar(&m, informe, "a_estrella", etiqueta, mapa, motor.expandidos - expandidos);
+
+    if (mapa->jerarquia != NULL) {
+        // ---- jerarquia_planear: A* abstracto entre pares de celdas libres al azar ----
+        medicion_iniciar(&m);
+        expandidos = busqueda.motor.expandidos;
+        for (; medicion_sigue(&m); m.operaciones++) {
+            Posicion inicio = celda_libre_al_azar(mapa, &semilla), objetivo = celda_libre_al_azar(mapa, &semilla);
+            jerarquia_planear(&busqueda, &vista, mapa_indice(mapa, inicio.x, inicio.y), mapa_indice(mapa, objetivo.x, objetivo.y));
+        }
+        medicion_terminar(&m, informe, "jerarquia_planear", etiqueta, mapa, busqueda.motor.expandidos - expandidos);
+
+        // ---- jerarquia_siguiente_paso: un fantasma camina hasta objetivos al azar (planes incluidos) ----
+        Posicion fantasma = celda_libre_al_azar(mapa, &semilla), objetivo = celda_libre_al_azar(mapa, &semilla);
+        busqueda.cluster_destino = -1;
+        medicion_iniciar(&m);
+        expandidos = busqueda.motor.expandidos;
+        for (; medicion_sigue(&m); m.operaciones++) {
+            Posicion paso = jerarquia_siguiente_paso(&busqueda, &cerca, &vista, fantasma, objetivo);
+            if (paso.x == fantasma.x && paso.y == fantasma.y) {
+                objetivo = celda_libre_al_azar(mapa, &semilla); // Llegó (o no hay camino): otro objetivo
+            }
+            fantasma = paso;
+        }
+        medicion_terminar(&m, informe, "jerarquia_siguiente_paso", etiqueta, mapa, busqueda.motor.expandidos - expandidos);
+
+        // ---- mapa_cambiar_celda: cierra y vuelve a abrir una celda libre al azar ----
+        if (mapa->nivel_pack == NULL) {
+            medicion_iniciar(&m);
+            for (; medicion_sigue(&m); m.operaciones += 2) {
+                Posicion celda = celda_libre_al_azar(mapa, &semilla);
+                char contenido = mapa->celdas[mapa_indice(mapa, celda.x, celda.y)];
+                mapa_cambiar_celda(mapa, celda.x, celda.y, OBSTACLE);
+                mapa_cambiar_celda(mapa, celda.x, celda.y, contenido);
             }
-            camino[longitud_camino++] = inicio; // Agrega la posición inicial al final del camino
+            medicion_terminar(&m, informe, "mapa_cambiar_celda", etiqueta, mapa, 0);
+        }
+    }
 
-            // Invierte el camino para que vaya del inicio al objetivo
-            for (int i = 0; i < longitud_camino / 2; i++) {
-                Posicion temp = camino[i];
-                camino[i] = camino[longitud_camino - i - 1];
-                camino[longitud_camino - i - 1] = temp;
+    // ---- dibujar_juego: cuadro completo y cuadro con un personaje que se mueve ----
+    int ancho = mapa->columnas * TILE_SIZE, alto = mapa->filas * TILE_SIZE;
+    SDL_Surface* superficie = (Sint64)ancho * alto <= PIXELES_MAXIMOS_MICRO ?
+        SDL_CreateRGBSurfaceWithFormat(0, ancho, alto, 32, SDL_PIXELFORMAT_RGBA8888) : NULL;
+    if (superficie != NULL && (renderer = SDL_CreateSoftwareRenderer(superficie)) != NULL) {
+        Posicion fantasmas[CANT_FANTASMAS];
+        memcpy(fantasmas, mapa->inicio_fantasmas, sizeof(fantasmas));
+        Personajes personajes = {mapa->inicio_pacman, fantasmas, CANT_FANTASMAS};
+
+        medicion_iniciar(&m);
+        for (; medicion_sigue(&m); m.operaciones++) {
+            escena_invalidar();
+            dibujar_juego(mapa, &puntos, &personajes);
+        }
+        medicion_terminar(&m, informe, "dibujar_juego (completo)", etiqueta, mapa, 0);
+
+        // Pac-Man va y viene entre su celda inicial y una vecina: se redibujan solo esas celdas
+        Posicion vecina = mapa->inicio_pacman;
+        for (int d = 0; d < 4; d++) {
+            Posicion p = {mapa->inicio_pacman.x + direcciones[d].x, mapa->inicio_pacman.y + direcciones[d].y};
+            if (vista_transitable(&vista, p.x, p.y)) {
+                vecina = p;
+                break;
             }
+        }
+        medicion_iniciar(&m);
+        for (; medicion_sigue(&m); m.operaciones++) {
+            personajes.pacman = m.operaciones % 2 ? vecina : mapa->inicio_pacman;
+            dibujar_juego(mapa, &puntos, &personajes);
+        }
+        medicion_terminar(&m, informe, "dibujar_juego (incremental)", etiqueta, mapa, 0);
+
+        escena_liberar();
+        SDL_DestroyRenderer(renderer);
+        renderer = NULL;
+    }
+    SDL_FreeSurface(superficie);
+    arena_liberar(&arena);
+    return 0;
+}
 
-            encontrado = 1; // Indica que se ha encontrado el camino
-            break; // Sale del bucle
+// Escribe una cadena como texto JSON (con las comillas y las barras escapadas)
+static void escribir_cadena_json(FILE* archivo, const char* texto) {
+    fputc('"', archivo);
+    for (; *texto != '\0'; texto++) {
+        if (*texto == '"' || *texto == '\\') {
+            fputc('\\', archivo);
         }
+        fputc(*texto, archivo);
+    }
+    fputc('"', archivo);
+}
 
-        // Explora los vecinos del nodo actual (arriba, abajo, izquierda, derecha)
-        for (int i = 0; i < 4; i++) {
-            // Calcula la posición del vecino
-            Posicion vecino = {nodo_actual.pos.x + direcciones[i].x, nodo_actual.pos.y + direcciones[i].y};
-
-            // Verifica si el vecino es válido (dentro del mapa, no es un obstáculo y no ha sido visitado)
-            if (vecino.x >= 0 && vecino.x < mapa.columnas && 
-                vecino.y >= 0 && vecino.y < mapa.filas &&
-                mapa.maze[vecino.y][vecino.x] != OBSTACLE &&
-                !lista_cerrada[vecino.y][vecino.x]) {
-
-                // Calcula los costos del vecino
-                int g = nodo_actual.g + 1; // Costo desde el inicio hasta el vecino
-                int h = distancia_manhattan(vecino, objetivo); // Heurística (distancia estimada al objetivo)
-                int f = g + h; // Costo total
-
-                // Verifica si el vecino ya está en la lista abierta
-                int en_lista = 0;
-                for (int j = 0; j < contador_abierta; j++) {
-                    if (lista_abierta[j].pos.x == vecino.x && lista_abierta[j].pos.y == vecino.y) {
-                        en_lista = 1;
-                        // Si el nuevo costo total es menor, actualiza el nodo en la lista abierta
-                        if (f < lista_abierta[j].f) {
-                            lista_abierta[j].g = g;
-                            lista_abierta[j].h = h;
-                            lista_abierta[j].f = f;
-                            recorrido[vecino.y][vecino.x] = nodo_actual.pos; // Registra el recorrido
-                        }
-                        break;
-                    }
-                }
+// =================== Función guardar_informe_json ===================
+// Guarda los resultados como un objeto JSON con un arreglo "resultados"
+// Retorna: 0 si se pudo guardar o -1 en caso de error
+int guardar_informe_json(const char* ruta, const InformeMicro* informe) {
+    FILE* archivo = fopen(ruta, "w");
+    if (archivo == NULL) {
+        printf("No se pudo crear el archivo %s\n", ruta);
+        return -1;
+    }
+    fprintf(archivo, "{\n  \"version\": 1,\n  \"resultados\": [\n");
+    for (int i = 0; i < informe->cantidad; i++) {
+        const ResultadoMicro* r = &informe->resultados[i];
+        fprintf(archivo, "    {\"nucleo\": ");
+        escribir_cadena_json(archivo, r->nucleo);
+        fprintf(archivo, ", \"mapa\": ");
+        escribir_cadena_json(archivo, r->mapa);
+        fprintf(archivo, ", \"columnas\": %d, \"filas\": %d, \"operaciones\": %llu, \"ns_por_op\": %.3f, "
+                         "\"nodos_por_op\": %.3f, \"asignaciones_por_op\": %.4f}%s\n",
+                r->columnas, r->filas, (unsigned long long)r->operaciones, r->ns_por_op, r->nodos_por_op,
+                r->asignaciones_por_op, i + 1 < informe->cantidad ? "," : "");
+    }
+    fprintf(archivo, "  ]\n}\n");
+    return fclose(archivo) == 0 ? 0 : -1;
+}
+
+// ===================== Función ejecutar_microbench =====================
+// Mide los núcleos sobre los mapas del juego (o del pack) y sobre los
+// laberintos sintéticos, que se escriben en archivos temporales nuevos y se borran al terminar
+// Parámetros:
+//   archivo_json: Archivo donde guardar los resultados, o NULL para solo imprimirlos
+// Retorna: 0 si se pudo medir todo o -1 en caso de error
+int ejecutar_microbench(const char* archivo_json) {
+    InformeMicro informe = {NULL, 0, 0};
+    int resultado = 0;
+    informar_precalculo = false;
+    printf("%-29s %-24s %12s %12s %12s %10s %10s\n", "Núcleo", "Mapa", "Tamaño", "ns/op", "nodos/op", "asign./op", "ops");
+
+    for (int i = 0; i < cant_niveles && resultado == 0; i++) {
+        if (cargar_mapa(&mapas[i]) == -1 || micro_medir_mapa(&mapas[i], mapas[i].nombre, &informe) == -1) {
+            resultado = -1;
+        }
+    }
+
+    int cant_tamanos = (int)(sizeof(tamanos_laberintos) / sizeof(tamanos_laberintos[0]));
+    for (int i = 0; i < cant_tamanos && resultado == 0; i++) {
+        char ruta[1024], etiqueta[64];
+        snprintf(etiqueta, sizeof(etiqueta), "laberinto_%dx%d", tamanos_laberintos[i][0], tamanos_laberintos[i][1]);
+        Mapa laberinto = {0};
+        laberinto.nombre = ruta;
+        if (generar_laberinto(ruta, sizeof(ruta), tamanos_laberintos[i][0], tamanos_laberintos[i][1], 1 + i) == -1) {
+            printf("No se pudo escribir el laberinto %s en la carpeta temporal\n", etiqueta);
+            resultado = -1;
+            break;
+        }
+        if (cargar_mapa(&laberinto) == -1 || micro_medir_mapa(&laberinto, etiqueta, &informe) == -1) {
+            resultado = -1;
+        }
+        mapa_liberar(&laberinto);
+        remove(ruta);
+    }
+
+    if (resultado == 0 && archivo_json != NULL) {
+        resultado = guardar_informe_json(archivo_json, &informe);
+    }
+    free(informe.resultados);
+    return resultado;
+}
 
-                // Si el vecino no estaba en la lista abierta, lo agrega
-                if (!en_lista) {
-                    Nodo nodo_vecino = {vecino, g, h, f};
-                    lista_abierta[contador_abierta++] = nodo_vecino;
-                    recorrido[vecino.y][vecino.x] = nodo_actual.pos;
+// ======================== Verificación del A* ========================
+// Comprueba la búsqueda A* incremental (motor_reenraizar, motor_reordenar y la
+// continuación de la lista abierta) contra las distancias exactas del campo de
+// distancias. Simula un fantasma que sigue su camino y un Pac-Man que camina
+// al azar, como en el juego, así cada consulta reutiliza el árbol anterior; de
+// vez en cuando el fantasma salta a otra celda para forzar búsquedas desde
+// cero. Cada consulta debe devolver un camino válido (celdas vecinas, del
+// fantasma a Pac-Man) de exactamente la distancia del BFS.
+#define CONSULTAS_VERIFICACION 3000     // Consultas por mapa
+#define SALTO_VERIFICACION 50           // Cada cuántas consultas el fantasma salta a una celda al azar
+
+// ==================== Función verificar_a_estrella ====================
+// Verifica el motor A* sobre un mapa ya cargado e informa por consola
+// Retorna: la cantidad de consultas incorrectas o -1 si no hay memoria
+int verificar_a_estrella(const Mapa* mapa, const char* etiqueta) {
+    int celdas = mapa_celdas(mapa);
+    Arena arena;
+    MotorAEstrella motor;
+    CampoDistancias campo;
+    int* camino = NULL;
+    if (arena_iniciar(&arena, motor_memoria(celdas) + campo_memoria(celdas) + arena_medida((size_t)celdas * sizeof(int))) == -1 ||
+        motor_iniciar(&motor, &arena, celdas) == -1 || campo_iniciar(&campo, &arena, celdas) == -1 ||
+        (camino = arena_reservar(&arena, (size_t)celdas * sizeof(int))) == NULL) {
+        arena_liberar(&arena);
+        return -1;
+    }
+    VistaMapa vista = vista_mapa(mapa);
+    Uint32 semilla = 12345;
+    Posicion fantasma = mapa->inicio_fantasmas[0], pacman = mapa->inicio_pacman;
+    int errores = 0;
+
+    for (int consulta = 0; consulta < CONSULTAS_VERIFICACION; consulta++) {
+        if (consulta % SALTO_VERIFICACION == SALTO_VERIFICACION - 1) {
+            fantasma = celda_libre_al_azar(mapa, &semilla);
+        }
+        int celda_fantasma = fantasma.y * mapa->paso + fantasma.x, celda_pacman = pacman.y * mapa->paso + pacman.x;
+        int longitud = a_estrella(&motor, &vista, fantasma, pacman);
+        campo_actualizar(&campo, &vista, pacman);
+        int esperada = campo.distancia[celda_fantasma];
+
+        // La longitud debe coincidir con el BFS y el camino debe ir de celda vecina en celda vecina
+        bool correcto = longitud == -1 ? esperada == -1 : longitud == esperada + 1;
+        if (correcto && longitud != -1) {
+            a_estrella_camino(&motor, celda_pacman, camino);
+            correcto = camino[0] == celda_fantasma && camino[longitud - 1] == celda_pacman;
+            for (int k = 1; k < longitud && correcto; k++) {
+                bool vecinas = false;
+                for (int d = 0; d < 4; d++) {
+                    vecinas |= (mapa->vecinos[camino[k - 1]] & (1u << d)) &&
+                               camino[k - 1] + direcciones[d].y * mapa->paso + direcciones[d].x == camino[k];
                 }
+                correcto = vecinas;
+            }
+        }
+        if (!correcto) {
+            if (errores < 5) {
+                printf("  %s: consulta %d, fantasma (%d,%d) y Pac-Man (%d,%d): A* da %d celdas y se esperaban %d, "
+                       "de celda vecina en celda vecina\n", etiqueta, consulta, fantasma.x, fantasma.y, pacman.x, pacman.y,
+                       longitud, esperada == -1 ? -1 : esperada + 1);
             }
+            errores++;
+            motor.raiz = -1; // Sigue verificando con un árbol nuevo
+        } else if (longitud > 1) {
+            fantasma = (Posicion){camino[1] % mapa->paso, camino[1] / mapa->paso}; // El fantasma avanza por su camino
+        }
+
+        // Pac-Man da un paso al azar (si la dirección elegida está libre)
+        int d = (int)(aleatorio_siguiente(&semilla) % 4);
+        if (mapa->vecinos[celda_pacman] & (1u << d)) {
+            pacman = (Posicion){pacman.x + direcciones[d].x, pacman.y + direcciones[d].y};
         }
     }
+    printf("%-24s %5dx%-5d %8d consultas %8d errores %12llu nodos\n", etiqueta, mapa->columnas, mapa->filas,
+           CONSULTAS_VERIFICACION, errores, (unsigned long long)motor.expandidos);
+    arena_liberar(&arena);
+    return errores;
+}
 
-    // Retorna la longitud del camino encontrado o -1 si no se encontró un camino
-    return encontrado ? longitud_camino : -1;
+// ====================== Función ejecutar_verificacion ======================
+// Verifica el A* en los mapas del juego (o del pack, o el de --mapa) y en
+// laberintos sintéticos, con ciclos, de dos tamaños
+// Retorna: 0 si todas las consultas fueron correctas o -1 si no
+int ejecutar_verificacion() {
+    static const int tamanos[][2] = {{101, 51}, {250, 250}};
+    int errores = 0;
+    for (int i = 0; i < cant_niveles; i++) {
+        int resultado = cargar_mapa(&mapas[i]) == -1 ? -1 : verificar_a_estrella(&mapas[i], mapas[i].nombre);
+        errores += resultado == -1 ? 1 : resultado;
+    }
+    for (int i = 0; i < (int)(sizeof(tamanos) / sizeof(tamanos[0])); i++) {
+        char ruta[1024], etiqueta[64];
+        snprintf(etiqueta, sizeof(etiqueta), "laberinto_%dx%d", tamanos[i][0], tamanos[i][1]);
+        Mapa laberinto = {0};
+        laberinto.nombre = ruta;
+        if (generar_laberinto(ruta, sizeof(ruta), tamanos[i][0], tamanos[i][1], 1 + i) == -1) {
+            printf("No se pudo escribir el laberinto %s en la carpeta temporal\n", etiqueta);
+            errores++;
+            continue;
+        }
+        int resultado = cargar_mapa(&laberinto) == -1 ? -1 : verificar_a_estrella(&laberinto, etiqueta);
+        errores += resultado == -1 ? 1 : resultado;
+        mapa_liberar(&laberinto);
+        remove(ruta);
+    }
+    printf(errores == 0 ? "El A* coincide con el BFS en todos los mapas\n" : "El A* falló en %d consultas\n", errores);
+    return errores == 0 ? 0 : -1;
 }
 
 int main(int argc, char* argv[]) {
@@ -583,192 +5609,483 @@ int main(int argc, char* argv[]) {
     // Nivel de dificultad inicial
     int nivel_actual = 0;
 
-    // Inicializar las rutas de los fantasmas usando el algoritmo A*
-    Posicion camino[LONGITUD_MAXIMA_CAMINO];
-    Posicion camino2[LONGITUD_MAXIMA_CAMINO];
-    Posicion camino3[LONGITUD_MAXIMA_CAMINO];
+    // Opciones del modo sin ventana (--headless) y de la medición de costos (--bench)
+    bool headless = false;
+    bool benchmark = false;
+    bool microbench = false;
+    bool verificar = false;
+    const char* archivo_json = NULL;
+#ifdef TRAZAS
+    const char* archivo_traza = NULL;
+#endif
+    const char* guion = NULL;
+    Uint32 semilla = 1;
+    Uint32 max_ticks = 10 * 60 * 1000 / PASO_SIMULACION_MS; // 10 minutos de juego por nivel
+
+    // Pack de niveles a jugar (--pack=archivo) y pack a armar con los mapas indicados (--compilar-pack=salida)
+    const char* pack = NULL;
+    const char* pack_salida = NULL;
+    char** archivos_pack = malloc(argc * sizeof(char*));
+    int cant_archivos_pack = 0;
+
+    // Partida a grabar (--grabar=archivo) o a reproducir (--reproducir=archivo)
+    const char* archivo_grabacion = NULL;
+    const char* archivo_reproduccion = NULL;
+
+    // Opciones del modo por lotes (--lote=N)
+    ConfiguracionLote lote = {0, 0, -1, 1, NULL, 0, 0, -1, {-1, -1, -1}, {-1, -1, -1}, NULL};
+    const char* nivel_lote = NULL;  // Valor de --nivel, o NULL para alternar los niveles
+
+    // Opciones de línea de comandos
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ia=a-estrella") == 0) {
+            modo_ia = IA_A_ESTRELLA;
+        } else if (strcmp(argv[i], "--ia=campo") == 0) {
+            modo_ia = IA_CAMPO_DISTANCIAS;
+        } else if (strcmp(argv[i], "--ia=tabla") == 0) {
+            // Los mapas se cargan con su tabla de saltos (si entra en el límite de memoria)
+            modo_ia = IA_TABLA_SALTOS;
+            precalcular_saltos = true;
+        } else if (strcmp(argv[i], "--ia=hpa") == 0) {
+            // Los mapas se cargan con su jerarquía de clusters para la búsqueda HPA*
+            modo_ia = IA_JERARQUICA;
+            precalcular_jerarquia = true;
+        } else if (strncmp(argv[i], "--fantasmas=", 12) == 0) {
+            // Fantasmas de cada nivel, separados por comas (el último vale para los niveles siguientes)
+            char* valor = argv[i] + 12;
+            cant_fantasmas_por_nivel = 0;
+            while (*valor != '\0' && cant_fantasmas_por_nivel < MAX_VALORES_FANTASMAS) {
+                long cantidad = strtol(valor, &valor, 10);
+                fantasmas_por_nivel[cant_fantasmas_por_nivel++] =
+                    cantidad < 1 ? 1 : cantidad > MAX_FANTASMAS ? MAX_FANTASMAS : (int)cantidad;
+                if (*valor != ',') {
+                    break;
+                }
+                valor++;
+            }
+        } else if (strncmp(argv[i], "--memoria-tabla=", 16) == 0) {
+            limite_tabla_saltos = (size_t)strtoul(argv[i] + 16, NULL, 10) * 1024 * 1024;
+        } else if (strncmp(argv[i], "--fps=", 6) == 0) {
+            // Limita los cuadros por segundo en lugar de usar vsync
+            limite_fps = atoi(argv[i] + 6);
+            if (limite_fps < 0) {
+                limite_fps = 0;
+            }
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strncmp(argv[i], "--guion=", 8) == 0) {
+            guion = argv[i] + 8;
+        } else if (strncmp(argv[i], "--semilla=", 10) == 0) {
+            semilla = (Uint32)strtoul(argv[i] + 10, NULL, 10);
+        } else if (strncmp(argv[i], "--max-ticks=", 12) == 0) {
+            max_ticks = (Uint32)strtoul(argv[i] + 12, NULL, 10);
+        } else if (strncmp(argv[i], "--lote=", 7) == 0) {
+            lote.partidas = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--mapa=", 7) == 0) {
+            // Juega un único nivel con el mapa indicado
+            mapas[0].nombre = argv[i] + 7;
+            cant_niveles = 1;
+        } else if (strncmp(argv[i], "--hilos=", 8) == 0) {
+            lote.hilos = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--nivel=", 8) == 0) {
+            nivel_lote = argv[i] + 8; // Se valida cuando se conoce la cantidad de niveles
+        } else if (strncmp(argv[i], "--variacion=", 12) == 0) {
+            lote.variacion = atoi(argv[i] + 12);
+        } else if (strncmp(argv[i], "--vel-pacman=", 13) == 0) {
+            lote.velocidad_pacman = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--vel-fantasmas=", 16) == 0) {
+            sscanf(argv[i] + 16, "%d,%d,%d", &lote.velocidad_fantasmas[0], &lote.velocidad_fantasmas[1], &lote.velocidad_fantasmas[2]);
+        } else if (strncmp(argv[i], "--salidas=", 10) == 0) {
+            sscanf(argv[i] + 10, "%d,%d,%d", &lote.salida_fantasmas[0], &lote.salida_fantasmas[1], &lote.salida_fantasmas[2]);
+        } else if (strncmp(argv[i], "--csv=", 6) == 0) {
+            lote.archivo_csv = argv[i] + 6;
+        } else if (strcmp(argv[i], "--marcador") == 0) {
+            mostrar_marcador = true;
+        } else if (strcmp(argv[i], "--estadisticas") == 0) {
+            mostrar_estadisticas = true;
+        } else if (strcmp(argv[i], "--audio=nulo") == 0) {
+            backend_audio = AUDIO_NULO;
+        } else if (strcmp(argv[i], "--audio=sdl") == 0) {
+            backend_audio = AUDIO_SDL;
+        } else if (strncmp(argv[i], "--audio-buffer=", 15) == 0) {
+            // Muestras del búfer del mezclador: menos muestras, menos retardo (y más trabajo para el audio)
+            muestras_audio = atoi(argv[i] + 15);
+            if (muestras_audio < 64) {
+                muestras_audio = 64;
+            } else if (muestras_audio > 8192) {
+                muestras_audio = 8192;
+            }
+        } else if (strncmp(argv[i], "--grabar=", 9) == 0) {
+            archivo_grabacion = argv[i] + 9;
+        } else if (strncmp(argv[i], "--reproducir=", 13) == 0) {
+            archivo_reproduccion = argv[i] + 13;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchmark = true;
+        } else if (strncmp(argv[i], "--traza=", 8) == 0 || strcmp(argv[i], "--traza-overlay") == 0) {
+#ifdef TRAZAS
+            if (argv[i][7] == '=') {
+                archivo_traza = argv[i] + 8;
+            } else {
+                mostrar_traza = true;
+            }
+#else
+            printf("La opción %s necesita compilar con -DTRAZAS\n", argv[i]);
+#endif
+        } else if (strcmp(argv[i], "--microbench") == 0) {
+            microbench = true;
+        } else if (strcmp(argv[i], "--verificar") == 0) {
+            verificar = true;
+        } else if (strncmp(argv[i], "--json=", 7) == 0) {
+            archivo_json = argv[i] + 7;
+        } else if (strncmp(argv[i], "--pack=", 7) == 0) {
+            pack = argv[i] + 7;
+        } else if (strncmp(argv[i], "--compilar-pack=", 16) == 0) {
+            pack_salida = argv[i] + 16;
+        } else if (strncmp(argv[i], "--", 2) != 0 && archivos_pack != NULL) {
+            // Los argumentos que no son opciones son los mapas del pack a armar
+            archivos_pack[cant_archivos_pack++] = argv[i];
+        }
+    }
+
+    // Un lote son muchas partidas a la vez y una reproducción ya tiene su grabación: no hay una partida que grabar
+    if (archivo_grabacion != NULL && (lote.partidas > 0 || archivo_reproduccion != NULL)) {
+        printf("Error: --grabar no se puede usar con %s\n", lote.partidas > 0 ? "--lote" : "--reproducir");
+        free(archivos_pack);
+        return -1;
+    }
+
+    // Arma un pack con los mapas indicados (o con los niveles incluidos) y termina
+    if (pack_salida != NULL) {
+        int resultado;
+        if (cant_archivos_pack > 0) {
+            resultado = compilar_pack(pack_salida, archivos_pack, cant_archivos_pack);
+        } else {
+            char* incluidos[cant_tot_niv];
+            for (int i = 0; i < cant_tot_niv; i++) {
+                incluidos[i] = mapas_incluidos[i].nombre;
+            }
+            resultado = compilar_pack(pack_salida, incluidos, cant_tot_niv);
+        }
+        free(archivos_pack);
+        return resultado == 0 ? 0 : -1;
+    }
+    free(archivos_pack);
+
+    // Juega los niveles del pack en lugar de los incluidos
+    if (pack != NULL && pack_abrir(pack) == -1) {
+        return -1;
+    }
+
+    // Mide el costo por tick sin abrir ventana ni audio
+    if (benchmark) {
+        return ejecutar_benchmark(200000) == 0 ? 0 : -1;
+    }
+
+    // Mide cada núcleo por separado, también sobre laberintos sintéticos
+    if (microbench) {
+        return ejecutar_microbench(archivo_json) == 0 ? 0 : -1;
+    }
+
+    // Compara la búsqueda A* con las distancias del BFS y termina con error si difieren
+    if (verificar) {
+        return ejecutar_verificacion() == 0 ? 0 : 1;
+    }
+
+    if (nivel_lote != NULL) {
+        lote.nivel = atoi(nivel_lote) - 1;
+        if (lote.nivel < 0 || lote.nivel >= cant_niveles) {
+            printf("Error: --nivel=%s no es un nivel válido (hay %d niveles)\n", nivel_lote, cant_niveles);
+            return -1;
+        }
+    }
+
+    // Modo por lotes: muchas partidas sin ventana en paralelo
+    if (lote.partidas > 0) {
+        lote.semilla = semilla;
+        lote.guion = guion;
+        lote.max_ticks = max_ticks;
+        return ejecutar_lote(&lote) == 0 ? 0 : -1;
+    }
+
+    // Reproduce una grabación sin ventana ni audio, tan rápido como se pueda
+    if (headless && archivo_reproduccion != NULL) {
+        return ejecutar_reproduccion(archivo_reproduccion) == 0 ? 0 : -1;
+    }
+
+    // Modo sin ventana ni audio: simula los niveles tan rápido como se pueda
+    if (headless) {
+        return ejecutar_headless(guion, semilla, max_ticks, archivo_grabacion) == 0 ? 0 : -1;
+    }
 
-    // Variables para almacenar la longitud del camino calculado por cada fantasma
-    int longitud_camino, longitud_camino2, longitud_camino3;
+    // Partida a reproducir en la ventana a velocidad real (la entrada sale de la
+    // grabación y el teclado solo sirve para salir), o partida a grabar
+    Reproduccion reproduccion = {0};
+    Grabacion grabacion = {NULL};
+    if (archivo_reproduccion != NULL) {
+        if (reproduccion_abrir(&reproduccion, archivo_reproduccion) == -1) {
+            return -1;
+        }
+    } else if (archivo_grabacion != NULL && grabacion_abrir(&grabacion, archivo_grabacion) == -1) {
+        return -1;
+    }
+    bool reproduciendo = reproduccion.datos != NULL;
 
-    // Cargar sonido del juego
-    cargar_sonido();
+    // Cargar los sonidos del juego (quedan en memoria hasta el final)
+    audio_iniciar(backend_audio, muestras_audio);
 
     // Indicador para salir del juego
     bool quit_game = false;
 
+    // Momento en que terminó el nivel anterior (0 si no hay un cambio de nivel en curso)
+    Uint64 inicio_cambio = 0;
+
     // ========================== Bucle Principal del Juego ==========================
     while (!quit_game) {
 
-        // Iniciar SDL y cargar el mapa del nivel actual
-        if (iniciar_SDL(mapas[nivel_actual]) == -1 || cargar_mapa(&mapas[nivel_actual]) == -1) {
-            perror("Error al inicializar SDL o cargar el mapa.");
+        // Al reproducir, el nivel y sus parámetros salen de la grabación (que ya cargó el mapa)
+        ParametrosIA parametros_grabados;
+        if (reproduciendo && (nivel_actual = reproduccion_nivel(&reproduccion, &parametros_grabados)) == -1) {
+            break;
+        }
+
+        // Cargar el mapa del nivel actual y adaptar la ventana a su tamaño
+        if (!reproduciendo && cargar_mapa(&mapas[nivel_actual]) == -1) {
+            perror("Error al cargar el mapa.");
+            cerrar_SDL();
             return -1;
         }
 
-        // Mensaje de inicio en el nivel 0
-        if (nivel_actual == 0) {
-            mostrar_mensaje(&mapas[nivel_actual], "Pac-Man", COLOR_PACMAN);
-            reproducir_y_liberar_sonido(inicioSound, true, 4200);
+        // Iniciar SDL con el primer mapa cargado: la ventana, el renderizador y sus texturas duran todo el juego
+        if (window == NULL && iniciar_SDL(&mapas[nivel_actual]) == -1) {
+            perror("Error al inicializar SDL.");
+            return -1;
+        }
+        ajustar_ventana(&mapas[nivel_actual]);
+        escena_invalidar();
+
+        // Estado del nivel: posiciones, velocidades y contadores de Pac-Man y los fantasmas
+        Simulacion sim;
+        if (simulacion_iniciar(&sim, &mapas[nivel_actual], nivel_actual, reproduciendo ? &parametros_grabados : NULL) == -1) {
+            printf("Error: no hay memoria para el nivel\n");
+            cerrar_SDL();
+            return -1;
         }
+        grabacion_nivel(&grabacion, &sim);
 
-        // Configuración de velocidades basadas en la dificultad
-        int velocidad_pacman = VELOCIDAD_PACMAN - (20 * nivel_actual);
-        int velocidad_fantasma = VELOCIDAD_FANTASMA - (25 * nivel_actual);
-        int velocidad_fantasma2 = VELOCIDAD_FANTASMA2 - (25 * nivel_actual);
-        int velocidad_fantasma3 = VELOCIDAD_FANTASMA3 - (30 * nivel_actual);
+        // Mensajes y animaciones que se muestran sin detener el bucle
+        ColaTransiciones transiciones = {0};
 
-        // Posiciones iniciales de Pac-Man y los fantasmas
-        Posicion pacman = {1, 6};
-        Posicion ghost = {9, 5};
-        Posicion ghost2 = {8, 5};
-        Posicion ghost3 = {12, 5};
-        enum Direccion direccion_actual = DERECHA;
+        // Mensaje de inicio en el nivel 0: el título queda en pantalla mientras suena la música de inicio
+        if (nivel_actual == 0) {
+            transicion_mensaje(&transiciones, "Pac-Man", COLOR_PACMAN);
+            transicion_agregar(&transiciones, TRANSICION_MENSAJE, "Pac-Man", COLOR_PACMAN, DURACION_INTRO_MS, SONIDO_INICIO);
+        }
+        transicion_mensaje(&transiciones, "Comenzando", COLOR_POINT);
 
         // Variables para controlar el ciclo del nivel
         bool quit_level = false;
-        int contador_pacman = 0, contador_fantasma = 0, contador_fantasma2 = 0, contador_fantasma3 = 0;
+        bool fin_nivel = false;         // El nivel terminó: se sale al terminar las transiciones
+        bool fin_juego = false;         // El juego terminó: se sale al terminar las transiciones
+        int accion = REPRODUCCION_SIGUE; // Saltar o salir, pedido por teclado o por la reproducción
 
-        // Contadores para el retardo de salida de los fantasmas
-        int Contador_Salida_fantasma2 = 0;
-        int Contador_Salida_fantasma3 = 0;
+        // ========================== Bucle del Nivel ==========================
+        // Reloj de la simulación y momento en que corresponde dibujar el próximo cuadro
+        RelojSimulacion reloj;
+        reloj_iniciar(&reloj);
+        Uint64 proximo_cuadro = SDL_GetPerformanceCounter();
 
-        // Reiniciar puntaje del nivel
-        puntaje = 0;
-        mostrar_mensaje(&mapas[nivel_actual], "Comenzando", COLOR_POINT);
+        // Cuadros por segundo medidos para el marcador
+        Uint64 inicio_segundo = proximo_cuadro;
+        int cuadros_segundo = 0, fps = 0;
 
-        // ========================== Bucle del Nivel ==========================
         while (!quit_level) {
-            // Renderizar el estado actual del juego
-            dibujar_juego(&mapas[nivel_actual], &pacman, ghost, ghost2, ghost3);
+            TRAZA_CUADRO_INICIO(sim.ticks, ia_nodos_expandidos(&sim.ia), estadisticas_dibujo.llamadas);
 
-            // Manejo de eventos SDL
+            // Manejo de eventos SDL (se atienden también durante los mensajes y animaciones)
             SDL_Event e;
+            TRAZA_ETAPA(ETAPA_EVENTOS)
             while (SDL_PollEvent(&e) != 0) {
                 if (e.type == SDL_QUIT) {
+                    // Cerrar la ventana sale de inmediato, aunque haya un mensaje en pantalla
+                    if (!fin_nivel && accion == REPRODUCCION_SIGUE) {
+                        grabacion_fin(&grabacion, &sim, ACCION_SALIR);
+                    }
                     quit_game = true;
                     quit_level = true;
-                } else if (e.type == SDL_KEYDOWN) {
+                } else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+                    // Se perdió el contenido de las texturas de la escena y del texto: se vuelven a crear
+                    escena_liberar();
+                    texto_liberar_textura();
+                } else if (e.type == SDL_KEYDOWN && !fin_nivel && accion == REPRODUCCION_SIGUE) {
+                    int tecla = -1;
                     switch (e.key.keysym.sym) {
-                        case SDLK_UP: direccion_actual = ARRIBA; break;
-                        case SDLK_DOWN: direccion_actual = ABAJO; break;
-                        case SDLK_LEFT: direccion_actual = IZQUIERDA; break;
-                        case SDLK_RIGHT: direccion_actual = DERECHA; break;
-                        case SDLK_e: // Saltar nivel
-                            mostrar_mensaje(&mapas[nivel_actual], "SALTAR NIVEL", COLOR_POINT);
-                            nivel_actual++;
-                            quit_level = true;
-                            break;
-                        case SDLK_q: // Salir del juego
-                            mostrar_mensaje(&mapas[nivel_actual], "SALIENDO DEL JUEGO", COLOR_PACMAN);
-                            quit_game = true;
-                            quit_level = true;
-                            break;
+                        case SDLK_UP: tecla = ARRIBA; break;
+                        case SDLK_DOWN: tecla = ABAJO; break;
+                        case SDLK_LEFT: tecla = IZQUIERDA; break;
+                        case SDLK_RIGHT: tecla = DERECHA; break;
+                        case SDLK_e: tecla = ACCION_SALTAR; break;
+                        case SDLK_q: tecla = ACCION_SALIR; break;
+                    }
+                    if (tecla >= ARRIBA && tecla <= DERECHA && !reproduciendo) {
+                        // La dirección se aplica antes del próximo tick: se graba con los ticks ya simulados
+                        sim.direccion = (enum Direccion)tecla;
+                        grabacion_entrada(&grabacion, sim.ticks, tecla);
+                    } else if (tecla == ACCION_SALIR || (tecla == ACCION_SALTAR && !reproduciendo)) {
+                        accion = tecla;
+                        grabacion_fin(&grabacion, &sim, (enum AccionGrabada)tecla);
                     }
                 }
             }
+            if (quit_level) {
+                break;
+            }
 
-            // ========================== Movimiento de Pac-Man ==========================
-            if (contador_pacman >= velocidad_pacman) {
-                Posicion nueva_posicion = {
-                    pacman.x + direcciones[direccion_actual].x,
-                    pacman.y + direcciones[direccion_actual].y
-                };
-                if (es_posicion_valida(mapas[nivel_actual], nueva_posicion, ghost, ghost2, ghost3)) {
-                    if (mapas[nivel_actual].maze[nueva_posicion.y][nueva_posicion.x] == POINT) {
-                        puntaje++;
-                        if (pacmanSound != NULL && !Mix_Playing(-1)) {
-                            Mix_PlayChannel(-1, pacmanSound, 0);
-                        }
-                        mapas[nivel_actual].maze[nueva_posicion.y][nueva_posicion.x] = PATH;
+            // Saltar o salir, con una tecla o porque así terminó el nivel en la grabación
+            if (accion == ACCION_SALTAR) {
+                // Saltar nivel (en el último nivel, termina el juego)
+                transicion_mensaje(&transiciones, "SALTAR NIVEL", COLOR_POINT);
+                fin_nivel = true;
+                fin_juego = nivel_actual == cant_niveles - 1;
+                nivel_actual++;
+            } else if (accion == ACCION_SALIR) {
+                // Salir del juego
+                transicion_mensaje(&transiciones, "SALIENDO DEL JUEGO", COLOR_PACMAN);
+                fin_nivel = true;
+                fin_juego = true;
+            }
+            accion = REPRODUCCION_SIGUE;
+
+            if (transiciones_activas(&transiciones)) {
+                // ========================== Mensajes y Animaciones ==========================
+                // El juego queda en pausa mientras se muestran; el reloj se reinicia al terminar
+                // para que la simulación no intente recuperar ese tiempo
+                Personajes personajes = simulacion_personajes(&sim);
+                TRAZA_ETAPA(ETAPA_TRANSICIONES) {
+                    transiciones_actualizar(&transiciones, &sim.mapa, &sim.puntos, &personajes);
+                }
+                if (!transiciones_activas(&transiciones)) {
+                    if (fin_juego && !quit_game) {
+                        // Mensaje final antes de salir del juego
+                        quit_game = true;
+                        transicion_mensaje(&transiciones, "JUEGO TERMINADO", COLOR_PACMAN);
+                    } else if (fin_nivel) {
+                        quit_level = true;
                     }
-                    pacman = nueva_posicion;
+                    reloj_iniciar(&reloj);
                 }
-                contador_pacman = 0;
             } else {
-                contador_pacman++;
-            }
+                // ========================== Simulación de Paso Fijo ==========================
+                // Ejecuta tantos ticks como milisegundos reales hayan pasado desde el cuadro anterior
+                int ticks_pendientes = reloj_ticks_pendientes(&reloj);
+                TRAZA_ETAPA(ETAPA_SIMULACION)
+                for (int tick = 0; tick < ticks_pendientes && !fin_nivel; tick++) {
+                    // Entradas grabadas para este tick; saltar o salir se atiende en el próximo cuadro
+                    if (reproduciendo && accion == REPRODUCCION_SIGUE) {
+                        int grabada = reproduccion_aplicar(&reproduccion, &sim);
+                        if (grabada != REPRODUCCION_SIGUE) {
+                            // Si la grabación se cortó a mitad del nivel, la reproducción termina ahí
+                            accion = grabada == REPRODUCCION_AGOTADA ? ACCION_SALIR : grabada;
+                            break;
+                        }
+                    }
+                    int eventos = simulacion_tick(&sim);
 
-            // ========================== Movimiento de Fantasmas ==========================
-            // Fantasma 1
-            if (contador_fantasma >= velocidad_fantasma) {
-                longitud_camino = a_estrella(mapas[nivel_actual], ghost, pacman, camino);
-                if (longitud_camino > 1 && es_posicion_valida(mapas[nivel_actual], camino[1], ghost, ghost2, ghost3)) {
-                    ghost = camino[1];
-                }
-                contador_fantasma = 0;
-            } else {
-                contador_fantasma++;
-            }
+                    // El nivel terminó solo: se graba o se compara con la grabación
+                    if (eventos & (EVENTO_COMPLETADO | EVENTO_MUERTE)) {
+                        grabacion_fin(&grabacion, &sim, (enum AccionGrabada)accion_de_eventos(eventos));
+                        if (reproduciendo) {
+                            reproduccion_verificar(&reproduccion, &sim, (enum AccionGrabada)accion_de_eventos(eventos));
+                        }
+                    }
 
-            // Fantasma 2
-            if (contador_fantasma2 >= velocidad_fantasma2 && SALIDA_FANTASMA2 <= Contador_Salida_fantasma2) {
-                longitud_camino2 = a_estrella(mapas[nivel_actual], ghost2, pacman, camino2);
-                if (longitud_camino2 > 1 && es_posicion_valida(mapas[nivel_actual], camino2[1], ghost, ghost2, ghost3)) {
-                    ghost2 = camino2[1];
-                }
-                contador_fantasma2 = 0;
-            } else {
-                if (SALIDA_FANTASMA2 > Contador_Salida_fantasma2) {
-                    Contador_Salida_fantasma2++;
-                } else {
-                    contador_fantasma2++;
-                }
-            }
+                    // Sonido al comer un punto
+                    if (eventos & EVENTO_PUNTO) {
+                        audio_reproducir(SONIDO_COMER);
+                    }
 
-            // Fantasma 3
-            if (contador_fantasma3 >= velocidad_fantasma3 && SALIDA_FANTASMA3 <= Contador_Salida_fantasma3) {
-                longitud_camino3 = a_estrella(mapas[nivel_actual], ghost3, pacman, camino3);
-                if (longitud_camino3 > 1 && es_posicion_valida(mapas[nivel_actual], camino3[1], ghost, ghost2, ghost3)) {
-                    ghost3 = camino3[1];
-                }
-                contador_fantasma3 = 0;
-            } else {
-                if (SALIDA_FANTASMA3 > Contador_Salida_fantasma3) {
-                    Contador_Salida_fantasma3++;
-                } else {
-                    contador_fantasma3++;
-                }
-            }
+                    if (eventos & EVENTO_COMPLETADO) {
+                        transicion_mensaje(&transiciones, "COMPLETADO", COLOR_PACMAN);
 
-            // ========================== Verificar Condiciones de Fin de Nivel ==========================
-            if (puntaje == puntos_totales || (nivel_actual == cant_tot_niv-1  && puntaje == puntos_totales - 1)) {
-                mostrar_mensaje(&mapas[nivel_actual], "COMPLETADO", COLOR_PACMAN);
-                
+                        if (nivel_actual == cant_niveles-1) {
+                            transicion_mensaje(&transiciones, "GANASTE!!", COLOR_PACMAN);
+                            fin_juego = true;
+                        }
+                        nivel_actual++;
+                        fin_nivel = true;
+                    } else if (eventos & EVENTO_MUERTE) {
+                        // Colisión de Pac-Man con un fantasma: animación de muerte y mensaje
+                        transicion_agregar(&transiciones, TRANSICION_MUERTE, NULL, COLOR_PACMAN, DURACION_MUERTE_MS, SONIDO_MUERTE);
+                        transicion_mensaje(&transiciones, "PERDISTE", COLOR_GHOST);
+                        fin_nivel = true;
+                        fin_juego = true;
+                    }
+                }
 
-                if (nivel_actual == cant_tot_niv-1) {
-                    mostrar_mensaje(&mapas[nivel_actual], "GANASTE!!", COLOR_PACMAN);
-                    quit_game = true;
+                // Renderizar el estado actual del juego
+                if (!fin_nivel) {
+                    if (mostrar_marcador) {
+                        Uint64 ahora = SDL_GetPerformanceCounter();
+                        cuadros_segundo++;
+                        if (ahora - inicio_segundo >= SDL_GetPerformanceFrequency()) {
+                            fps = cuadros_segundo;
+                            cuadros_segundo = 0;
+                            inicio_segundo = ahora;
+                        }
+                        snprintf(texto_marcador, sizeof(texto_marcador), "NIVEL %d  PUNTOS %d/%d  FPS %d",
+                                 sim.nivel + 1, puntos_comidos(&sim.puntos), sim.puntos.totales, fps);
+                    }
+                    Personajes personajes = simulacion_personajes(&sim);
+                    TRAZA_ETAPA(ETAPA_DIBUJO) {
+                        componer_juego(&sim.mapa, &sim.puntos, &personajes);
+                    }
+                    TRAZA_ETAPA(ETAPA_PRESENTAR) {
+                        SDL_RenderPresent(renderer); // Con vsync, acá se espera al monitor
+                    }
                 }
-                nivel_actual++;
-                quit_level = true;
             }
 
-            // Verificar colisión de Pac-Man con los fantasmas
-            if ((pacman.x == ghost.x && pacman.y == ghost.y) ||
-                (pacman.x == ghost2.x && pacman.y == ghost2.y) ||
-                (pacman.x == ghost3.x && pacman.y == ghost3.y)) {
-                Animacion_Muerte(&mapas[nivel_actual], pacman, ghost, ghost2, ghost3);
-                quit_game = true;
-                quit_level = true;
+            // Costo del cambio de nivel: desde el fin del nivel anterior hasta el primer cuadro de este
+            if (inicio_cambio != 0) {
+                estadisticas_cambio_nivel(inicio_cambio);
+                inicio_cambio = 0;
             }
 
-            SDL_Delay(1);
-        
+            // Con límite de FPS, duerme hasta el próximo cuadro (con vsync, la presentación ya espera)
+            if (limite_fps > 0) {
+                proximo_cuadro += SDL_GetPerformanceFrequency() / limite_fps;
+                Uint64 ahora = SDL_GetPerformanceCounter();
+                if (proximo_cuadro < ahora) {
+                    proximo_cuadro = ahora; // Si el cuadro se atrasó, no se intenta recuperar
+                }
+                TRAZA_ETAPA(ETAPA_ESPERA) {
+                    esperar_hasta(proximo_cuadro);
+                }
+            }
+            TRAZA_CUADRO_FIN(sim.ticks, ia_nodos_expandidos(&sim.ia), estadisticas_dibujo.llamadas);
         }
 
-        // Destruir recursos SDL del nivel actual
-        if (quit_game){
-            mostrar_mensaje(&mapas[nivel_actual - 1], "JUEGO TERMINADO", COLOR_PACMAN);
-        }
-        SDL_DestroyRenderer(renderer);
-        SDL_DestroyWindow(window);
+        // Liberar el estado del nivel; la ventana y el renderizador se conservan
+        simulacion_liberar(&sim);
+        inicio_cambio = SDL_GetPerformanceCounter();
     }
+    cerrar_SDL();
+    grabacion_cerrar(&grabacion);
+#ifdef TRAZAS
+    if (archivo_traza != NULL) {
+        traza_exportar(archivo_traza);
+    }
+#endif
+    reproduccion_cerrar(&reproduccion);
 
     // ========================== Finalizar Juego ==========================
-    SDL_Delay(2000);
+    if (mostrar_estadisticas) {
+        estadisticas_imprimir();
+        audio_imprimir_estadisticas();
+    }
 
+    texto_cerrar();
+    audio_cerrar();
+    pack_cerrar();
     SDL_Quit();
-    Mix_CloseAudio();
     return 0;
 }